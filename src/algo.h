@@ -1,13 +1,119 @@
-#include "utils.h"
-
+#ifndef ALGO_H
+#define ALGO_H
+
+#include "arena.h"
+#include "compressed_graph.h"
+#include "dense_graph.h"
+#include "numa.h"
+#include "partition_view.h"
+#include "perf_counters.h"
+#include "pipeline.h"
+#include "support.h"
+#include "trace.h"
+#include "writer.h"
+
+#include <chrono>
+#include <array>
+#include <atomic>
 #include <deque>
+#include <memory_resource>
+#include <numeric>
+#include <omp.h>
+#include <optional>
 #include <random>
 
 enum visited_state { UNVISITED, VISITED, QUEUED };
 
+// Wall clock deadline for the anytime mode. Long running loops check it
+// between steps and stop early, keeping what they found so far. Every step
+// leaves the result planar, so stopping anywhere gives a valid result
+typedef std::chrono::steady_clock::time_point deadline;
+const deadline NO_DEADLINE = deadline::max();
+
+bool past_deadline(const deadline &time_limit) {
+    return time_limit != NO_DEADLINE && std::chrono::steady_clock::now() >= time_limit;
+}
+
+// The graphlets propagate_from_x looks for around each node, in the order
+// given by algo_options
+enum graphlet { HOUSES, HOUSES_ALT, DIAMONDS, DIAMONDS_ALT, TRIANGLES, NUM_GRAPHLETS };
+
+typedef std::array<graphlet, NUM_GRAPHLETS> graphlet_order;
+
+const graphlet_order DEFAULT_GRAPHLET_ORDER = {HOUSES, HOUSES_ALT, DIAMONDS, DIAMONDS_ALT,
+    TRIANGLES};
+
+// Progress of one run of a portfolio, shared between its threads, used to
+// stop it once it can't beat the best finished run
+struct run_progress {
+    std::atomic<size_t> edges {0};
+    std::atomic<size_t> covered {0};
+    std::atomic<size_t> components {0};
+    size_t num_nodes = 0;
+    // edges of the best finished run
+    const std::atomic<size_t> *best_edges = nullptr;
+
+    // The most edges the run can still end up with. Graphlets add at most
+    // 2 edges for each node they reach, and bridging adds at most 2 for
+    // each component, which each start from a node
+    size_t upper_bound() const {
+	return edges + 2 * (num_nodes - std::min(num_nodes, (size_t) covered)) + 2 * components;
+    }
+
+    bool cannot_win() const {
+	return best_edges != nullptr && upper_bound() < best_edges->load();
+    }
+};
+
+// Optional outputs and settings of algo_routine
+struct algo_options {
+    // if set, edges are sent to the writer as each partition finishes
+    edge_writer *writer = nullptr;
+    // if set, filled with the hardware counters of each thread
+    std::vector<counter_values> *thread_counters = nullptr;
+    // propagation and component connection stop early once this has passed
+    deadline time_limit = NO_DEADLINE;
+    // if set, the number of nodes reached by the propagation is added to it
+    size_t *nodes_covered = nullptr;
+    // pin threads to cpus, spread over the NUMA nodes, and give each thread
+    // its own first touch copy of its partitions
+    bool pin_threads = false;
+    // if set, filled with the NUMA node each thread ran on
+    std::vector<int> *thread_numa_nodes = nullptr;
+    // seed for partitioning and random start nodes
+    uint32_t seed = 42;
+    // start each partition from a random node instead of the max degree one
+    bool random_start = false;
+    graphlet_order order = DEFAULT_GRAPHLET_ORDER;
+    // number of partitions, 0 for one per thread
+    size_t num_partitions = 0;
+    // if set, progress is reported to it and the run stops once it can't win
+    run_progress *progress = nullptr;
+    // partitions with at most this many nodes are searched as a dense_graph,
+    // 0 to always use the input representation
+    size_t dense_max_nodes = DENSE_GRAPH_MAX_NODES;
+    // if set, the triangle support histogram of each partition is added to
+    // it
+    std::vector<size_t> *support_histogram = nullptr;
+    // threads counting triangle support for each partition, 0 for the
+    // OpenMP default. Within propagate_partitions it runs on the partition's
+    // own thread either way, as nested parallelism is off
+    int support_threads = 0;
+    // if set, the edges added to connect components are appended to it
+    // instead of going to the writer, so they can still be taken back if the
+    // result needs repairing
+    edge_list *bridges = nullptr;
+};
+
+// Node sets and queues used by the graphlet search. They take a memory
+// resource so the search loop can run without heap allocations
+typedef std::pmr::unordered_set<node> node_set;
+typedef std::pmr::deque<node> node_queue;
+
 // Starting at a node, performs a BFS to identify the entire component that
 // the node is in
-std::vector<node> node_bfs(const node &start_node, const adjacency_list &adj_list) {
+template <typename G>
+std::vector<node> node_bfs(const node &start_node, const G &adj_list) {
     std::deque<node> queue;
     std::unordered_set<node> visited;
 
@@ -24,7 +130,7 @@ std::vector<node> node_bfs(const node &start_node, const adjacency_list &adj_lis
             visited.insert(current_node);
             component.push_back(current_node);
 
-            for (node adj : adj_list.at(current_node)) {
+            for (node adj : get_adjs(adj_list, current_node)) {
                 search = visited.find(adj);
                 if (search == visited.end()) {
                     queue.push_back(adj);
@@ -38,7 +144,7 @@ std::vector<node> node_bfs(const node &start_node, const adjacency_list &adj_lis
 
 // Given an adjancey list, returns a vec of vec of nodes, where each vec of
 // nodes are all the nodes in a single connected component
-std::vector<std::vector<node>> get_components(const adjacency_list adj_list) {
+std::vector<std::vector<node>> get_components(const adjacency_list &adj_list) {
     std::unordered_set<node> unvisited_nodes;
 
     for (auto &[key_node, _adjs] : adj_list) {
@@ -62,10 +168,13 @@ std::vector<std::vector<node>> get_components(const adjacency_list adj_list) {
 
 // Given an adjacency list, a vector of vector of nodes giving the components, 
 // and the original graph, this connects the components with a single edge or 
-// a triangle if possible, if these edges were present in the original graph
-void connect_components(adjacency_list &adj_list, 
+// a triangle if possible, if these edges were present in the original graph.
+// Returns the edges that were added. Stops early, with some components left
+// unconnected, once time_limit has passed
+template <typename G>
+edge_list connect_components(adjacency_list &adj_list, 
 	const std::vector<std::vector<node>> &components,
-                        const adjacency_list &original_graph) {
+                        const G &original_graph, const deadline time_limit = NO_DEADLINE) {
     std::unordered_map<size_t, visited_state> state;
     std::unordered_map<node, size_t> node_to_comp;
 
@@ -80,7 +189,7 @@ void connect_components(adjacency_list &adj_list,
     edge_list edges;
     queue.push_back(0);
 
-    while (!queue.empty()) {
+    while (!queue.empty() && !past_deadline(time_limit)) {
         size_t current_comp = queue.front();
         queue.pop_front();
 
@@ -88,16 +197,21 @@ void connect_components(adjacency_list &adj_list,
             state.at(current_comp) = VISITED;
 
             for (node node_0 : components.at(current_comp)) {
-                std::vector<node> adjs = original_graph.at(node_0);
+                const auto &adjs = get_adjs(original_graph, node_0);
 
                 for (node node_1 : adjs) {
-                    size_t node_1_comp = node_to_comp.at(node_1);
+		    // adjacents outside of out, e.g. on another rank, are skipped
+		    auto comp_search = node_to_comp.find(node_1);
+		    if (comp_search == node_to_comp.end()) {
+			continue;
+		    }
+                    size_t node_1_comp = comp_search->second;
 
                     if (state.at(node_1_comp) == UNVISITED && current_comp != node_1_comp) {
                         state.at(node_1_comp) = QUEUED;
 			edges.push_back(std::make_pair(node_0, node_1));
 			
-			std::vector<node> node_1_adjs = adj_list.at(node_1);
+			const std::vector<node> &node_1_adjs = adj_list.at(node_1);
 			// TODO add logic for triangles the other way
 			for (node node_2 : node_1_adjs) {
 			    auto adjs_search = std::find(adjs.begin(), adjs.end(),
@@ -128,38 +242,131 @@ void connect_components(adjacency_list &adj_list,
     for (std::pair<node, node> edge : edges) {
         add_edge(adj_list, edge.first, edge.second);
     }
+
+    return edges;
+}
+
+// Adjacents of the hubs of a graph, the nodes with at least HUB_MIN_DEGREE
+// adjacents, as hash sets. Built once per graph, so that graphlet checks
+// involving a hub are O(1) probes instead of scans of its adjacents, and x
+// doesn't need its aux set rebuilt in every search when it is a hub. The
+// other nodes have short adjacents that are cheap to scan
+#define HUB_MIN_DEGREE 256
+
+typedef std::unordered_set<node> hub_adjs;
+
+struct hub_index {
+    std::unordered_map<node, hub_adjs> hubs;
+};
+
+template <typename G>
+hub_index make_hub_index(const G &adj_list, const size_t min_degree = HUB_MIN_DEGREE) {
+    hub_index index;
+    for_each_node(adj_list, [&](const node key_node) {
+	if (get_degree(adj_list, key_node) >= min_degree) {
+	    const auto &adjs = get_adjs(adj_list, key_node);
+	    index.hubs.emplace(key_node, hub_adjs(adjs.begin(), adjs.end()));
+	}
+    });
+    return index;
+}
+
+// Gets the adjacents of a hub, nullptr if the node isn't one
+const hub_adjs *find_hub(const hub_index &index, const node key_node) {
+    if (index.hubs.empty()) {
+	return nullptr;
+    }
+    auto search = index.hubs.find(key_node);
+    return search == index.hubs.end() ? nullptr : &search->second;
+}
+
+// Tests for the edge node_0 - node_1, given the adjacents of node_0. Probes
+// the hub set of either node if it has one, and scans adjs otherwise
+template <typename A>
+bool has_edge(const hub_index &index, const node node_0, const A &adjs, const node node_1) {
+    if (const hub_adjs *hub = find_hub(index, node_0)) {
+	return hub->count(node_1) > 0;
+    }
+    if (const hub_adjs *hub = find_hub(index, node_1)) {
+	return hub->count(node_0) > 0;
+    }
+    return std::find(adjs.begin(), adjs.end(), node_1) != adjs.end();
+}
+
+// The adjacents of x during one graphlet search. A hub uses its set in the
+// hub index, other nodes get a set from the arena. Nodes are never erased
+// from it, every check against it also checks nu, which they leave instead
+struct aux_set {
+    const hub_adjs *hub;
+    node_set adjs;
+};
+
+template <typename A>
+aux_set make_aux(const node x, const A &x_adjs, const hub_index &index,
+	scratch_arena &arena) {
+    const hub_adjs *hub = find_hub(index, x);
+    if (hub != nullptr) {
+	return aux_set {hub, node_set(&arena)};
+    }
+    return aux_set {nullptr, node_set(x_adjs.begin(), x_adjs.end(), x_adjs.size(),
+	    std::hash<node>(), std::equal_to<node>(), &arena)};
+}
+
+bool contains(const aux_set &aux, const node key_node) {
+    return aux.hub != nullptr ? aux.hub->count(key_node) > 0 : aux.adjs.count(key_node) > 0;
+}
+
+// Nodes adjacent to both node_0 and node_1 are normally looked for among the
+// adjacents of node_0. When node_0 is a hub with more adjacents than node_1,
+// they are looked for among node_1's instead, checking each against node_0's
+// hub set. Returns that set if so, nullptr otherwise
+template <typename A>
+const hub_adjs *swap_hub(const hub_index &index, const node node_0, const A &adjs_0,
+	const A &adjs_1) {
+    const hub_adjs *hub = find_hub(index, node_0);
+    return hub != nullptr && adjs_1.size() < adjs_0.size() ? hub : nullptr;
 }
 
 // Adds houses, w/ alternate orbit node, back to the graph from x
-void add_houses_alt(const node x, const adjacency_list &adj_list,
-	std::unordered_set<node> &nu, std::vector<node> &out, 
-	std::deque<node> &active) {
+template <typename G>
+void add_houses_alt(const node x, const G &adj_list, const hub_index &index,
+	const edge_support &support, node_set &nu, std::vector<node> &out, node_queue &active,
+	scratch_arena &arena) {
     
-    std::vector<node> x_adjs = adj_list.at(x);
-    std::unordered_set<node> aux(x_adjs.begin(), x_adjs.end());
+    const auto &x_adjs = get_adjs(adj_list, x);
+    const aux_set aux = make_aux(x, x_adjs, index, arena);
+    const uint32_t *x_support = get_support(support, x);
+    size_t y_idx = 0;
     for (node y : x_adjs) {
+	// an edge in no triangle is in no graphlet
+	if (x_support[y_idx++] == 0) {
+	    continue;
+	}
 	auto search = nu.find(y);
 	if (search != nu.end()) {
-	    std::vector<node> y_adjs = adj_list.at(y);
+	    const auto &y_adjs = get_adjs(adj_list, y);
+	    const hub_adjs *y_hub = swap_hub(index, y, y_adjs, x_adjs);
 	    
 	    bool found = false;
 
-	    for (node z : y_adjs) {
+	    for (node z : y_hub != nullptr ? x_adjs : y_adjs) {
 		search = nu.find(z);
-		auto aux_search = aux.find(z);
-		if (search != nu.end() && aux_search != aux.end()) {
-		    std::vector<node> z_adjs = adj_list.at(z);
-		    for (node w : z_adjs) {
+		if (search != nu.end() && contains(aux, z) &&
+			(y_hub == nullptr || y_hub->count(z) > 0)) {
+		    const auto &z_adjs = get_adjs(adj_list, z);
+		    const hub_adjs *z_hub = swap_hub(index, z, z_adjs, y_adjs);
+		    for (node w : z_hub != nullptr ? y_adjs : z_adjs) {
 			search = nu.find(w);
-			auto y_search = std::find(y_adjs.begin(), y_adjs.end(), w);
 			
-			if (search != nu.end() && y_search != y_adjs.end()) {
-			    for (node v : y_adjs) {
+			if (search != nu.end() && (z_hub != nullptr ?
+				z_hub->count(w) > 0 : has_edge(index, y, y_adjs, w))) {
+			    const auto &w_adjs = get_adjs(adj_list, w);
+			    const hub_adjs *v_hub = swap_hub(index, y, y_adjs, w_adjs);
+			    for (node v : v_hub != nullptr ? w_adjs : y_adjs) {
 				if (v != z && v != w) {
-				    std::vector<node> w_adjs = adj_list.at(w);
 				    search = nu.find(v);
-				    auto w_search = std::find(w_adjs.begin(), w_adjs.end(), v);
-				    if (search != nu.end() && w_search != w_adjs.end()) {
+				    if (search != nu.end() && (v_hub != nullptr ?
+					    v_hub->count(v) > 0 : has_edge(index, w, w_adjs, v))) {
 			    // Here edges are just being added in a vector
 			    // and the pair relationships are accounted for 
 			    // later. Doing it this way to keep edges in 
@@ -189,11 +396,6 @@ void add_houses_alt(const node x, const adjacency_list &adj_list,
 					nu.erase(w);
 					nu.erase(v);
 
-					aux.erase(y);
-					aux.erase(z);
-					aux.erase(w);
-					aux.erase(v);
-
 					found = true;
 
 					break;
@@ -211,34 +413,43 @@ void add_houses_alt(const node x, const adjacency_list &adj_list,
 }
 
 // Adds houses back to the graph from x
-void add_houses(const node x, const adjacency_list &adj_list,
-	std::unordered_set<node> &nu, std::vector<node> &out, 
-	std::deque<node> &active) {
+template <typename G>
+void add_houses(const node x, const G &adj_list, const hub_index &index,
+	const edge_support &support, node_set &nu, std::vector<node> &out, node_queue &active,
+	scratch_arena &arena) {
     
-    std::vector<node> x_adjs = adj_list.at(x);
-    std::unordered_set<node> aux(x_adjs.begin(), x_adjs.end());
-     for (node y : x_adjs) {
+    const auto &x_adjs = get_adjs(adj_list, x);
+    const aux_set aux = make_aux(x, x_adjs, index, arena);
+    const uint32_t *x_support = get_support(support, x);
+    size_t y_idx = 0;
+    for (node y : x_adjs) {
+	// an edge in no triangle is in no graphlet
+	if (x_support[y_idx++] == 0) {
+	    continue;
+	}
 	auto search = nu.find(y);
 	if (search != nu.end()) {
-	    std::vector<node> y_adjs = adj_list.at(y);
+	    const auto &y_adjs = get_adjs(adj_list, y);
+	    const hub_adjs *y_hub = swap_hub(index, y, y_adjs, x_adjs);
 	    
 	    bool found = false;
 
-	    for (node z : y_adjs) {
+	    for (node z : y_hub != nullptr ? x_adjs : y_adjs) {
 		search = nu.find(z);
-		auto aux_search = aux.find(z);
-		if (search != nu.end() && aux_search != aux.end()) {
-		    std::vector<node> z_adjs = adj_list.at(z);
-		    for (node w : z_adjs) {
+		if (search != nu.end() && contains(aux, z) &&
+			(y_hub == nullptr || y_hub->count(z) > 0)) {
+		    const auto &z_adjs = get_adjs(adj_list, z);
+		    const hub_adjs *z_hub = swap_hub(index, z, z_adjs, x_adjs);
+		    for (node w : z_hub != nullptr ? x_adjs : z_adjs) {
 			search = nu.find(w);
-			aux_search = aux.find(w);
 			
-			if (search != nu.end() && aux_search != aux.end()) {
-			    for (node v : y_adjs) {
+			if (search != nu.end() && contains(aux, w) &&
+				(z_hub == nullptr || z_hub->count(w) > 0)) {
+			    for (node v : y_hub != nullptr ? x_adjs : y_adjs) {
 				if (v != z && v != w) {
 				    search = nu.find(v);
-				    aux_search = aux.find(v);
-				    if (search != nu.end() && aux_search != aux.end()) {
+				    if (search != nu.end() && contains(aux, v) &&
+					    (y_hub == nullptr || y_hub->count(v) > 0)) {
 			    // Here edges are just being added in a vector
 			    // and the pair relationships are accounted for 
 			    // later. Doing it this way to keep edges in 
@@ -268,11 +479,6 @@ void add_houses(const node x, const adjacency_list &adj_list,
 					nu.erase(w);
 					nu.erase(v);
 
-					aux.erase(y);
-					aux.erase(z);
-					aux.erase(w);
-					aux.erase(v);
-
 					found = true;
 
 					break;
@@ -290,28 +496,37 @@ void add_houses(const node x, const adjacency_list &adj_list,
 }
 
 // Adds diamonds w/ alternate orbit node back to the graph from X
-void add_diamonds_alt(const node x, const adjacency_list &adj_list,
-	std::unordered_set<node> &nu, std::vector<node> &out, 
-	std::deque<node> &active) {
+template <typename G>
+void add_diamonds_alt(const node x, const G &adj_list, const hub_index &index,
+	const edge_support &support, node_set &nu, std::vector<node> &out, node_queue &active,
+	scratch_arena &arena) {
     
-    std::vector<node> x_adjs = adj_list.at(x);
-    std::unordered_set<node> aux(x_adjs.begin(), x_adjs.end());
-     for (node y : x_adjs) {
+    const auto &x_adjs = get_adjs(adj_list, x);
+    const aux_set aux = make_aux(x, x_adjs, index, arena);
+    const uint32_t *x_support = get_support(support, x);
+    size_t y_idx = 0;
+    for (node y : x_adjs) {
+	// an edge in no triangle is in no graphlet
+	if (x_support[y_idx++] == 0) {
+	    continue;
+	}
 	auto search = nu.find(y);
 	if (search != nu.end()) {
-	    std::vector<node> y_adjs = adj_list.at(y);
+	    const auto &y_adjs = get_adjs(adj_list, y);
+	    const hub_adjs *y_hub = swap_hub(index, y, y_adjs, x_adjs);
 	    
 	    bool found = false;
 
-	    for (node z : y_adjs) {
+	    for (node z : y_hub != nullptr ? x_adjs : y_adjs) {
 		search = nu.find(z);
-		auto aux_search = aux.find(z);
-		if (search != nu.end() && aux_search != aux.end()) {
-		    std::vector<node> z_adjs = adj_list.at(z);
-		    for (node w : z_adjs) {
+		if (search != nu.end() && contains(aux, z) &&
+			(y_hub == nullptr || y_hub->count(z) > 0)) {
+		    const auto &z_adjs = get_adjs(adj_list, z);
+		    const hub_adjs *z_hub = swap_hub(index, z, z_adjs, y_adjs);
+		    for (node w : z_hub != nullptr ? y_adjs : z_adjs) {
 			search = nu.find(w);
-			auto aux_search = std::find(y_adjs.begin(), y_adjs.end(), w);
-			if (search != nu.end() && aux_search != y_adjs.end()) {
+			if (search != nu.end() && (z_hub != nullptr ?
+				z_hub->count(w) > 0 : has_edge(index, y, y_adjs, w))) {
 			    // Here edges are just being added in a vector
 			    // and the pair relationships are accounted for 
 			    // later. Doing it this way to keep edges in 
@@ -335,10 +550,6 @@ void add_diamonds_alt(const node x, const adjacency_list &adj_list,
 			    nu.erase(z);
 			    nu.erase(w);
 
-			    aux.erase(y);
-			    aux.erase(z);
-			    aux.erase(w);
-
 			    found = true;
 
 			    break;
@@ -352,28 +563,37 @@ void add_diamonds_alt(const node x, const adjacency_list &adj_list,
 } 
 
 // Adds diamonds back to the graph from x
-void add_diamonds(const node x, const adjacency_list &adj_list,
-	std::unordered_set<node> &nu, std::vector<node> &out, 
-	std::deque<node> &active) {
+template <typename G>
+void add_diamonds(const node x, const G &adj_list, const hub_index &index,
+	const edge_support &support, node_set &nu, std::vector<node> &out, node_queue &active,
+	scratch_arena &arena) {
     
-    std::vector<node> x_adjs = adj_list.at(x);
-    std::unordered_set<node> aux(x_adjs.begin(), x_adjs.end());
-     for (node y : x_adjs) {
+    const auto &x_adjs = get_adjs(adj_list, x);
+    const aux_set aux = make_aux(x, x_adjs, index, arena);
+    const uint32_t *x_support = get_support(support, x);
+    size_t y_idx = 0;
+    for (node y : x_adjs) {
+	// an edge in no triangle is in no graphlet
+	if (x_support[y_idx++] == 0) {
+	    continue;
+	}
 	auto search = nu.find(y);
 	if (search != nu.end()) {
-	    std::vector<node> y_adjs = adj_list.at(y);
+	    const auto &y_adjs = get_adjs(adj_list, y);
+	    const hub_adjs *y_hub = swap_hub(index, y, y_adjs, x_adjs);
 	    
 	    bool found = false;
 
-	    for (node z : y_adjs) {
+	    for (node z : y_hub != nullptr ? x_adjs : y_adjs) {
 		search = nu.find(z);
-		auto aux_search = aux.find(z);
-		if (search != nu.end() && aux_search != aux.end()) {
-		    std::vector<node> z_adjs = adj_list.at(z);
-		    for (node w : z_adjs) {
+		if (search != nu.end() && contains(aux, z) &&
+			(y_hub == nullptr || y_hub->count(z) > 0)) {
+		    const auto &z_adjs = get_adjs(adj_list, z);
+		    const hub_adjs *z_hub = swap_hub(index, z, z_adjs, x_adjs);
+		    for (node w : z_hub != nullptr ? x_adjs : z_adjs) {
 			search = nu.find(w);
-			aux_search = aux.find(w);
-			if (search != nu.end() && aux_search != aux.end()) {
+			if (search != nu.end() && contains(aux, w) &&
+				(z_hub == nullptr || z_hub->count(w) > 0)) {
 			    // Here edges are just being added in a vector
 			    // and the pair relationships are accounted for 
 			    // later. Doing it this way to keep edges in 
@@ -397,10 +617,6 @@ void add_diamonds(const node x, const adjacency_list &adj_list,
 			    nu.erase(z);
 			    nu.erase(w);
 
-			    aux.erase(y);
-			    aux.erase(z);
-			    aux.erase(w);
-
 			    found = true;
 
 			    break;
@@ -414,20 +630,28 @@ void add_diamonds(const node x, const adjacency_list &adj_list,
 }  
 
 // Adds triangles back to the graph from x
-void add_triangles(const node x, const adjacency_list &adj_list, 
-    std::unordered_set<node> &nu, std::vector<node> &out, std::deque<node> &active) {
-    std::vector<node> x_adjs = adj_list.at(x);
-    std::unordered_set<node> aux(x_adjs.begin(), x_adjs.end());
-
+template <typename G>
+void add_triangles(const node x, const G &adj_list, const hub_index &index,
+    const edge_support &support, node_set &nu, std::vector<node> &out, node_queue &active, scratch_arena &arena) {
+    const auto &x_adjs = get_adjs(adj_list, x);
+    const aux_set aux = make_aux(x, x_adjs, index, arena);
+
+    const uint32_t *x_support = get_support(support, x);
+    size_t y_idx = 0;
     for (node y : x_adjs) {
+	// an edge in no triangle is in no graphlet
+	if (x_support[y_idx++] == 0) {
+	    continue;
+	}
 	auto search = nu.find(y);
 	if (search != nu.end()) {
-	    std::vector<node> y_adjs = adj_list.at(y);
+	    const auto &y_adjs = get_adjs(adj_list, y);
+	    const hub_adjs *y_hub = swap_hub(index, y, y_adjs, x_adjs);
 
-	    for (node z : y_adjs) {
+	    for (node z : y_hub != nullptr ? x_adjs : y_adjs) {
 		search = nu.find(z);
-		auto aux_search = aux.find(z);
-		if (search != nu.end() && aux_search != aux.end()) {
+		if (search != nu.end() && contains(aux, z) &&
+			(y_hub == nullptr || y_hub->count(z) > 0)) {
 
 		    // add the edges to out, again, this is not super
 		    // clear right now and should be cleaned up. possibly
@@ -445,9 +669,6 @@ void add_triangles(const node x, const adjacency_list &adj_list,
 		    nu.erase(y);
 		    nu.erase(z);
 
-		    aux.erase(y);
-		    aux.erase(z);
-
 		    break;
 		}
 	    }
@@ -462,194 +683,793 @@ void add_triangles(const node x, const adjacency_list &adj_list,
 // NOTE: returning a vec<node> here, this is basically an
 // edge list or matrix of dim 2, this is not entirely clear. doing it
 // this way just for speed
-std::vector<node> propagate_from_x(const size_t x_node, const adjacency_list &adj_list) {
+//
+// Looks for graphlets in the order given by options. Stops early once the
+// time limit has passed or the run can't win. If nodes_covered is given, it
+// is set to the number of nodes the propagation reached
+template <typename G>
+std::vector<node> propagate_from_x(const size_t x_node, const G &adj_list,
+	const algo_options &options = algo_options(), size_t *nodes_covered = nullptr) {
     std::vector<node> out;
-    std::unordered_set<node> nu;
-    std::deque<node> active {x_node};
+    // erased nodes go back to the pool, and each x's scratch data comes from
+    // a per-thread arena that is reset before every step
+    std::pmr::unsynchronized_pool_resource pool;
+    node_set nu(&pool);
+    node_queue active({x_node}, &pool);
+    scratch_arena &arena = get_scratch_arena();
+    const hub_index index = make_hub_index(adj_list);
+    uint64_t span_start = trace_start();
+    const edge_support support = compute_support(adj_list, options.support_threads);
+    trace_complete("support", span_start);
+    if (options.support_histogram != nullptr) {
+#pragma omp critical(support_histogram)
+	add_support_histogram(adj_list, support, *options.support_histogram);
+    }
+    // restarts go to the most supported unreached node
+    size_t next_restart = 0;
 
-    for (auto &[key_node, _adjs] : adj_list) {
+    nu.reserve(num_nodes(adj_list));
+    for_each_node(adj_list, [&](const node key_node) {
         nu.insert(key_node);
-    }
+    });
     
     nu.erase(x_node);
 
-    while (!nu.empty()) {
+    run_progress *progress = options.progress;
+    size_t reported_edges = 0;
+    size_t reported_remaining = nu.size() + 1;
+    if (progress != nullptr) {
+	progress->components++;
+    }
+
+    while (!nu.empty() && !past_deadline(options.time_limit)) {
 	if (active.empty()) {
-	    node temp = *nu.begin();
+	    while (next_restart < support.num_supported &&
+		    nu.count(support.order.at(next_restart)) == 0) {
+		next_restart++;
+	    }
+	    if (next_restart == support.num_supported) {
+		// none of the rest is in a triangle, so each is a component
+		// of its own
+		if (progress != nullptr) {
+		    progress->components += nu.size();
+		    progress->covered += nu.size();
+		}
+		nu.clear();
+		break;
+	    }
+	    node temp = support.order.at(next_restart);
 	    active.push_front(temp);
 	    nu.erase(temp);	    
+	    if (progress != nullptr) {
+		progress->components++;
+	    }
 	}
 
         const node x = active.front();
         active.pop_front();
-	add_houses(x, adj_list, nu, out, active);
-	add_houses_alt(x, adj_list, nu, out, active);
-	add_diamonds(x, adj_list, nu, out, active);
-	add_diamonds_alt(x, adj_list, nu, out, active);
-	add_triangles(x, adj_list, nu, out, active);
+	arena.reset();
+	// x can only start a graphlet from an edge in a triangle
+	if (has_support(support, x, get_degree(adj_list, x))) {
+	    for (graphlet this_graphlet : options.order) {
+		switch (this_graphlet) {
+		    case HOUSES:
+			add_houses(x, adj_list, index, support, nu, out, active, arena);
+			break;
+		    case HOUSES_ALT:
+			add_houses_alt(x, adj_list, index, support, nu, out, active, arena);
+			break;
+		    case DIAMONDS:
+			add_diamonds(x, adj_list, index, support, nu, out, active, arena);
+			break;
+		    case DIAMONDS_ALT:
+			add_diamonds_alt(x, adj_list, index, support, nu, out, active, arena);
+			break;
+		    case TRIANGLES:
+			add_triangles(x, adj_list, index, support, nu, out, active, arena);
+			break;
+		    case NUM_GRAPHLETS:
+			break;
+		}
+	    }
+	}
+
+	if (progress != nullptr) {
+	    progress->edges += out.size() / 2 - reported_edges;
+	    progress->covered += reported_remaining - nu.size();
+	    reported_edges = out.size() / 2;
+	    reported_remaining = nu.size();
+	    if (progress->cannot_win()) {
+		break;
+	    }
+	}
+    }
 
+    if (nodes_covered != nullptr) {
+	*nodes_covered = num_nodes(adj_list) - nu.size();
     }
 
     return out;
 }
 
-// Partitions nodes from the original graph so that the algorithm can 
-// be performed in parallel on each partition
-//
-// First, randomly selects nodes. Then starts adding nodes to each partition
-// using BFS. Finally, just adds leftover nodes to available partitions
-std::vector<adjacency_list> partition_nodes(const adjacency_list &adj_list, 
-	const size_t num_partitions) {
-    std::vector<adjacency_list> partitions;
-    
-    if (num_partitions == 1) {
-	partitions.push_back(adj_list);
-	return partitions;
+// The graphlet searches on a dense_graph. They find the same graphlets as
+// the ones above, in the same order as long as there are no hubs, but nu is
+// a bit set and aux is just x's row of the matrix. Before walking the
+// adjacents of y, the rows of x and y and nu are ANDed together, and y is
+// skipped if no node z is in all three, as every graphlet needs such a z
+
+// Moves the nodes of a found graphlet from nu to the front of active
+void take_nodes(dense_set &nu, std::deque<node> &active, std::initializer_list<node> nodes) {
+    for (node this_node : nodes) {
+	active.push_front(this_node);
     }
+    for (node this_node : nodes) {
+	clear_bit(nu.data(), this_node);
+    }
+}
 
-    std::unordered_set<node> node_set;
-    node_set.reserve(adj_list.size());
+// Tests whether y is in nu and has a z in nu adjacent to both x and y
+bool has_candidates(const node x, const node y, const dense_graph &graph, const dense_set &nu) {
+    return test_bit(nu.data(), y) &&
+	any_common(dense_row(graph, x), dense_row(graph, y), nu.data(), graph.words);
+}
 
-    for (auto &[key_node, _adjs] : adj_list) {
-	node_set.insert(key_node);
-    }
-    
-    std::mt19937 generator(42);
+void add_houses_alt(const node x, const dense_graph &graph, dense_set &nu,
+	std::vector<node> &out, std::deque<node> &active) {
+    for (node y : get_adjs(graph, x)) {
+	if (!has_candidates(x, y, graph, nu)) {
+	    continue;
+	}
+	const std::vector<node> &y_adjs = get_adjs(graph, y);
+	bool found = false;
 
-    for (size_t _ = 0; _ < num_partitions; _++) {
-	std::uniform_int_distribution<> distribution(0, node_set.size() - 1);
-	auto iter = node_set.begin();
-	std::advance(iter, distribution(generator));
+	for (node z : y_adjs) {
+	    if (!test_bit(nu.data(), z) || !has_edge(graph, x, z)) {
+		continue;
+	    }
+	    for (node w : get_adjs(graph, z)) {
+		if (!test_bit(nu.data(), w) || !has_edge(graph, y, w)) {
+		    continue;
+		}
+		for (node v : y_adjs) {
+		    if (v != z && v != w && test_bit(nu.data(), v) && has_edge(graph, w, v)) {
+			out.insert(out.end(), {x, y, x, z, y, z, y, w, z, w, y, v, w, v});
+			take_nodes(nu, active, {y, z, w, v});
+			found = true;
+			break;
+		    }
+		}
+		if (found) {break;}
+	    }
+	    if (found) {break;}
+	}
+    }
+}
 
-	adjacency_list new_adj_list;
-	add_node(new_adj_list, *iter, adj_list.at(*iter).size());
-	node_set.erase(iter);
-	partitions.push_back(new_adj_list);
-    } 
+void add_houses(const node x, const dense_graph &graph, dense_set &nu,
+	std::vector<node> &out, std::deque<node> &active) {
+    for (node y : get_adjs(graph, x)) {
+	if (!has_candidates(x, y, graph, nu)) {
+	    continue;
+	}
+	const std::vector<node> &y_adjs = get_adjs(graph, y);
+	bool found = false;
 
-    // add neighbors first
-    for (size_t idx = 0; idx < partitions.size(); idx++) {
-	node node_0 = partitions.at(idx).begin()->first;
-	for (node node_1 : adj_list.at(node_0)) {
-	    auto search = node_set.find(node_1);
-	    if (search != node_set.end()) {
-		add_node(partitions.at(idx), node_1, adj_list.at(node_1).size());
-		
-		// neighbors that are in the partition need their
-		// edges
-		for (node adj : adj_list.at(node_1)) {
-		    auto search = partitions.at(idx).find(adj);
-		    if (search != partitions.at(idx).end()) {
-			add_edge(partitions.at(idx), node_1, adj);
+	for (node z : y_adjs) {
+	    if (!test_bit(nu.data(), z) || !has_edge(graph, x, z)) {
+		continue;
+	    }
+	    for (node w : get_adjs(graph, z)) {
+		if (!test_bit(nu.data(), w) || !has_edge(graph, x, w)) {
+		    continue;
+		}
+		for (node v : y_adjs) {
+		    if (v != z && v != w && test_bit(nu.data(), v) && has_edge(graph, x, v)) {
+			out.insert(out.end(), {x, y, x, z, y, z, x, w, z, w, y, v, x, v});
+			take_nodes(nu, active, {y, z, w, v});
+			found = true;
+			break;
 		    }
 		}
-		node_set.erase(node_1);
-	    }	    
+		if (found) {break;}
+	    }
+	    if (found) {break;}
 	}
     }
-   
-    size_t num_nodes = node_set.size(); 
+}
 
-    // start adding nodes to partitions with BFS
+void add_diamonds_alt(const node x, const dense_graph &graph, dense_set &nu,
+	std::vector<node> &out, std::deque<node> &active) {
+    for (node y : get_adjs(graph, x)) {
+	if (!has_candidates(x, y, graph, nu)) {
+	    continue;
+	}
+	bool found = false;
+
+	for (node z : get_adjs(graph, y)) {
+	    if (!test_bit(nu.data(), z) || !has_edge(graph, x, z)) {
+		continue;
+	    }
+	    for (node w : get_adjs(graph, z)) {
+		if (test_bit(nu.data(), w) && has_edge(graph, y, w)) {
+		    out.insert(out.end(), {x, y, x, z, y, z, y, w, z, w});
+		    take_nodes(nu, active, {y, z, w});
+		    found = true;
+		    break;
+		}
+	    }
+	    if (found) {break;}
+	}
+    }
+}
+
+void add_diamonds(const node x, const dense_graph &graph, dense_set &nu,
+	std::vector<node> &out, std::deque<node> &active) {
+    for (node y : get_adjs(graph, x)) {
+	if (!has_candidates(x, y, graph, nu)) {
+	    continue;
+	}
+	bool found = false;
+
+	for (node z : get_adjs(graph, y)) {
+	    if (!test_bit(nu.data(), z) || !has_edge(graph, x, z)) {
+		continue;
+	    }
+	    for (node w : get_adjs(graph, z)) {
+		if (test_bit(nu.data(), w) && has_edge(graph, x, w)) {
+		    out.insert(out.end(), {x, y, x, z, y, z, x, w, z, w});
+		    take_nodes(nu, active, {y, z, w});
+		    found = true;
+		    break;
+		}
+	    }
+	    if (found) {break;}
+	}
+    }
+}
+
+void add_triangles(const node x, const dense_graph &graph, dense_set &nu,
+	std::vector<node> &out, std::deque<node> &active) {
+    for (node y : get_adjs(graph, x)) {
+	if (!has_candidates(x, y, graph, nu)) {
+	    continue;
+	}
+
+	for (node z : get_adjs(graph, y)) {
+	    if (test_bit(nu.data(), z) && has_edge(graph, x, z)) {
+		out.insert(out.end(), {x, y, x, z, y, z});
+		take_nodes(nu, active, {y, z});
+		break;
+	    }
+	}
+    }
+}
+
+// propagate_from_x on a dense_graph. x_node and the search use local ids,
+// the edges returned are mapped back to the ids of the source graph. When
+// nothing is active, the search restarts from the most supported unreached
+// node, like the sparse search
+std::vector<node> propagate_from_x(const size_t x_node, const dense_graph &graph,
+	const algo_options &options = algo_options(), size_t *nodes_covered = nullptr) {
+    std::vector<node> out;
+    if (num_nodes(graph) == 0) {
+	if (nodes_covered != nullptr) {
+	    *nodes_covered = 0;
+	}
+	return out;
+    }
+
+    uint64_t span_start = trace_start();
+    const edge_support support = compute_support(graph, options.support_threads);
+    trace_complete("support", span_start);
+    if (options.support_histogram != nullptr) {
+#pragma omp critical(support_histogram)
+	add_support_histogram(graph, support, *options.support_histogram);
+    }
+    size_t next_restart = 0;
+
+    dense_set nu(graph.words, 0);
+    std::deque<node> active({x_node});
+    for_each_node(graph, [&](const node key_node) {
+	set_bit(nu.data(), key_node);
+    });
+    clear_bit(nu.data(), x_node);
+    // bits are only ever cleared, so the lowest set word never moves back
+    size_t first_word = 0;
+
+    run_progress *progress = options.progress;
+    size_t reported_edges = 0;
+    size_t reported_remaining = num_nodes(graph);
+    if (progress != nullptr) {
+	progress->components++;
+    }
+
+    while (!past_deadline(options.time_limit)) {
+	while (first_word < graph.words && nu.at(first_word) == 0) {
+	    first_word++;
+	}
+	if (first_word == graph.words) {
+	    break;
+	}
+
+	if (active.empty()) {
+	    while (next_restart < support.num_supported &&
+		    !test_bit(nu.data(), support.order.at(next_restart))) {
+		next_restart++;
+	    }
+	    if (next_restart == support.num_supported) {
+		// none of the rest is in a triangle, so each is a component
+		// of its own
+		const size_t remaining = count_bits(nu.data(), graph.words);
+		if (progress != nullptr) {
+		    progress->components += remaining;
+		    progress->covered += remaining;
+		}
+		std::fill(nu.begin(), nu.end(), 0);
+		break;
+	    }
+	    const node temp = support.order.at(next_restart);
+	    active.push_front(temp);
+	    clear_bit(nu.data(), temp);
+	    if (progress != nullptr) {
+		progress->components++;
+	    }
+	}
+
+	const node x = active.front();
+	active.pop_front();
+	for (graphlet this_graphlet : options.order) {
+	    switch (this_graphlet) {
+		case HOUSES:
+		    add_houses(x, graph, nu, out, active);
+		    break;
+		case HOUSES_ALT:
+		    add_houses_alt(x, graph, nu, out, active);
+		    break;
+		case DIAMONDS:
+		    add_diamonds(x, graph, nu, out, active);
+		    break;
+		case DIAMONDS_ALT:
+		    add_diamonds_alt(x, graph, nu, out, active);
+		    break;
+		case TRIANGLES:
+		    add_triangles(x, graph, nu, out, active);
+		    break;
+		case NUM_GRAPHLETS:
+		    break;
+	    }
+	}
+
+	if (progress != nullptr) {
+	    const size_t remaining = count_bits(nu.data(), graph.words);
+	    progress->edges += out.size() / 2 - reported_edges;
+	    progress->covered += reported_remaining - remaining;
+	    reported_edges = out.size() / 2;
+	    reported_remaining = remaining;
+	    if (progress->cannot_win()) {
+		break;
+	    }
+	}
+    }
+
+    if (nodes_covered != nullptr) {
+	*nodes_covered = num_nodes(graph) - count_bits(nu.data(), graph.words);
+    }
+
+    for (node &this_node : out) {
+	this_node = graph.ids.at(this_node);
+    }
+
+    return out;
+}
+
+// Runs propagate_from_x on one graph from the start node chosen by options,
+// with seed for random starts. Graphs with at most dense_max_nodes nodes are
+// converted to a dense_graph first. This is decided for each graph at
+// runtime, so the partitions of one run can take different paths
+template <typename G>
+std::vector<node> propagate_graph(const G &graph, const algo_options &options,
+	const uint32_t seed, size_t *nodes_covered = nullptr) {
+    if (num_nodes(graph) <= options.dense_max_nodes) {
+	const dense_graph dense = make_dense(graph);
+	const node init_x = options.random_start ?
+	    get_random_node(dense, seed) : get_max_degree_node(dense);
+	return propagate_from_x(init_x, dense, options, nodes_covered);
+    }
+
+    const node init_x = options.random_start ?
+	get_random_node(graph, seed) : get_max_degree_node(graph);
+    return propagate_from_x(init_x, graph, options, nodes_covered);
+}
+
+// Partitions nodes from the original graph so that the algorithm can 
+// be performed in parallel on each partition. Partitions are views of the
+// original graph, which has to outlive them
+//
+// First, randomly selects nodes. Then starts adding nodes to each partition
+// using BFS. Finally, just adds leftover nodes to available partitions.
+// There are never more partitions than nodes, as each starts from its own node
+template <typename G>
+std::vector<partition_view<G>> partition_nodes(const G &adj_list, const size_t max_partitions,
+	const uint32_t seed = 42) {
+    const size_t num_partitions = std::max<size_t>(1,
+	    std::min<size_t>(max_partitions, num_nodes(adj_list)));
+    std::shared_ptr<partition_map> map = std::make_shared<partition_map>();
+    std::vector<partition_view<G>> partitions(num_partitions);
     for (size_t idx = 0; idx < partitions.size(); idx++) {
-	size_t num_nodes_added = 0;
+	partitions.at(idx).graph = &adj_list;
+	partitions.at(idx).id = idx;
+    }
+
+    node max_node = 0;
+    for_each_node(adj_list, [&](const node key_node) {
+	max_node = std::max(max_node, key_node);
+    });
+    init_partition_map(*map, num_nodes(adj_list), max_node);
+
+    // nodes not in a partition yet
+    std::unordered_set<node> node_set;
+    auto add_to_partition = [&](const size_t idx, const node key_node) {
+	set_partition(*map, key_node, idx);
+	partitions.at(idx).nodes.push_back(key_node);
+	node_set.erase(key_node);
+    };
+
+    if (num_partitions == 1) {
+	for_each_node(adj_list, [&](const node key_node) {
+	    add_to_partition(0, key_node);
+	});
+    } else {
+	node_set.reserve(num_nodes(adj_list));
+	for_each_node(adj_list, [&](const node key_node) {
+	    node_set.insert(key_node);
+	});
+
+	std::mt19937 generator(seed);
+
+	for (size_t idx = 0; idx < partitions.size(); idx++) {
+	    std::uniform_int_distribution<> distribution(0, node_set.size() - 1);
+	    auto iter = node_set.begin();
+	    std::advance(iter, distribution(generator));
+	    add_to_partition(idx, *iter);
+	} 
+
+	// add neighbors first
+	for (size_t idx = 0; idx < partitions.size(); idx++) {
+	    const node node_0 = partitions.at(idx).nodes.front();
+	    for (node node_1 : get_adjs(adj_list, node_0)) {
+		if (node_set.count(node_1) > 0) {
+		    add_to_partition(idx, node_1);
+		}	    
+	    }
+	}
+   
+	size_t num_nodes = node_set.size(); 
+
+	// start adding nodes to partitions with BFS
+	for (size_t idx = 0; idx < partitions.size(); idx++) {
+	    size_t num_nodes_added = 0;
 	
-	std::deque<node> queue;
-	std::unordered_set<node> visited;
-	queue.push_back(partitions.at(idx).begin()->first);
-
-	while (!queue.empty() && num_nodes_added < num_nodes / num_partitions) {
-	    const size_t queue_len = queue.size();
-
-	    for (size_t _ = 0; _ < queue_len; _++) {
-		node current_node = queue.front();
-		queue.pop_front();
-
-		auto search = visited.find(current_node);
-		if (search == visited.end()) {
-		    visited.insert(current_node);
-		    std::vector<node> adjs = adj_list.at(current_node);
-		    for (node node_0 : adjs) {
-			auto search = node_set.find(node_0);
-			if (search != node_set.end()) {
-			    add_node(partitions.at(idx), node_0, adj_list.at(node_0).size());
+	    // from the seed and its neighbors, as the seed's unassigned
+	    // neighbors were all just taken
+	    std::deque<node> queue(partitions.at(idx).nodes.begin(),
+		    partitions.at(idx).nodes.end());
+	    std::unordered_set<node> visited;
+
+	    while (!queue.empty() && num_nodes_added < num_nodes / num_partitions) {
+		const size_t queue_len = queue.size();
+
+		for (size_t _ = 0; _ < queue_len; _++) {
+		    node current_node = queue.front();
+		    queue.pop_front();
+
+		    auto search = visited.find(current_node);
+		    if (search == visited.end()) {
+			visited.insert(current_node);
+			for (node node_0 : get_adjs(adj_list, current_node)) {
+			    if (node_set.count(node_0) > 0) {
+				add_to_partition(idx, node_0);
 			    
-			    search = visited.find(node_0);
-			    if (search == visited.end()) {
-				queue.push_back(node_0);
-			    }
-
-			    num_nodes_added++;
-			    // for each neighbor from the original graph,
-			    // if the neighbor is in the partition, edges should
-			    // be added
-			    for (node node_1 : adj_list.at(node_0)) {
-				auto search = partitions.at(idx).find(node_1);
-				if (search != partitions.at(idx).end()) {
-				    add_edge(partitions.at(idx), node_0, node_1);
+				search = visited.find(node_0);
+				if (search == visited.end()) {
+				    queue.push_back(node_0);
 				}
-			    }
-			    node_set.erase(node_0);
 
+				num_nodes_added++;
+			    }
 			}
 		    }
 		}
 	    }
 	}
     }
-    
+
     size_t idx = 0;
     while (!node_set.empty()) {
 	if (idx >= partitions.size()) {
 	    idx = 0;
 	}
 
-	node this_node = *node_set.begin();
-	add_node(partitions.at(idx), this_node, adj_list.at(this_node).size());
-	for (node node_1 : adj_list.at(this_node)) {
-	    auto search = partitions.at(idx).find(node_1);
-	    if (search != partitions.at(idx).end()) {
-		add_edge(partitions.at(idx), this_node, node_1);
-	    }
-	}
-	node_set.erase(this_node);
+	add_to_partition(idx, *node_set.begin());
 	idx++;
     }
 
+    // degrees within the partitions, so views know their adjacents' sizes
+    for_each_node(adj_list, [&](const node key_node) {
+	const uint32_t id = get_partition(*map, key_node);
+	uint32_t degree = 0;
+	for (node adj : get_adjs(adj_list, key_node)) {
+	    degree += get_partition(*map, adj) == id;
+	}
+	set_partition_degree(*map, key_node, degree);
+    });
+
+    for (partition_view<G> &partition : partitions) {
+	partition.map = map;
+    }
+
     return partitions;
 } 
 
-// The main algorithm routine, driver of everything here.
-// Partitions nodes, then runs the graphlet propagation from the maximum
-// degree node in each partition. Connects components at the end, if possible
-adjacency_list algo_routine(const adjacency_list &adj_list, const int threads) {
-    adjacency_list out;
-    out.reserve(adj_list.size());
-
-    for (auto &[key_node, adjs] : adj_list) {
-        add_node(out, key_node, adjs.size());
+// Runs the graphlet propagation from the maximum degree node of each of
+// the partitions given by indices, in parallel, adding the edges found to out.
+// With pin_threads, each thread searches its own copy of the partition
+template <typename G>
+void propagate_partitions(const std::vector<partition_view<G>> &partitions,
+	const std::vector<size_t> &indices,
+	adjacency_list &out, const int threads, const algo_options &options = algo_options()) {
+    if (options.thread_counters != nullptr) {
+	options.thread_counters->assign(threads, empty_counter_values());
+    }
+    if (options.thread_numa_nodes != nullptr) {
+	options.thread_numa_nodes->assign(threads, 0);
+    }
+    std::vector<int> cpus;
+    if (options.pin_threads) {
+	cpus = get_allowed_cpus();
     }
-    std::vector<adjacency_list> partitions = partition_nodes(adj_list, threads);
 
-#pragma omp parallel for num_threads(threads)
-    for (adjacency_list partition : partitions) {
-	const node init_x = get_max_degree_node(partition);
-	const std::vector<node> edges = propagate_from_x(init_x, partition);
+#pragma omp parallel num_threads(threads)
+    {
+	// unpinned when the region ends
+	std::optional<thread_pin> pin;
+	if (!cpus.empty()) {
+	    pin.emplace(cpus.at(omp_get_thread_num() % cpus.size()));
+	}
+	if (options.thread_numa_nodes != nullptr) {
+	    options.thread_numa_nodes->at(omp_get_thread_num()) = current_numa_node();
+	}
+
+#pragma omp for nowait
+	for (size_t idx : indices) {
+	    if (options.progress != nullptr && options.progress->cannot_win()) {
+		continue;
+	    }
+
+	    perf_counters counters;
+	    if (options.thread_counters != nullptr) {
+		counters = start_counters();
+	    }
+
+	    uint64_t span_start = trace_start();
+	    size_t partition_covered = 0;
+	    std::vector<node> edges;
+	    if (options.pin_threads) {
+		// the copy is first touched by this thread, so it lives on this
+		// thread's node rather than the one that holds the graph
+		const G local_partition = materialize(partitions.at(idx));
+		edges = propagate_graph(local_partition, options, options.seed + idx,
+			&partition_covered);
+	    } else {
+		edges = propagate_graph(partitions.at(idx), options, options.seed + idx,
+			&partition_covered);
+	    }
+	    trace_complete("propagate", span_start, idx);
+
+	    if (options.writer != nullptr) {
+		options.writer->push(edges);
+	    }
 	
+	    span_start = trace_start();
 #pragma omp critical(out)
-	{
-	    for (size_t idx = 0; idx < edges.size(); idx += 2) {
-		add_edge(out, edges.at(idx), edges.at(idx + 1));
+	    {
+		trace_complete("merge wait", span_start, idx);
+		trace_scope merge_span("merge", idx);
+		for (size_t edge_idx = 0; edge_idx < edges.size(); edge_idx += 2) {
+		    add_edge(out, edges.at(edge_idx), edges.at(edge_idx + 1));
+		}
+
+		if (options.nodes_covered != nullptr) {
+		    *options.nodes_covered += partition_covered;
+		}
+
+		if (options.thread_counters != nullptr) {
+		    add_counter_values(options.thread_counters->at(omp_get_thread_num()),
+			    stop_counters(counters));
+		}
 	    }
+
 	}
 
+	// time spent waiting here is time the thread sat idle while others
+	// still had partitions to finish
+	const uint64_t barrier_start = trace_start();
+#pragma omp barrier
+	trace_complete("barrier wait", barrier_start);
     }
-    
+}
+
+// Connects the components of out using edges of the original graph, if
+// there is more than one
+template <typename G>
+void bridge_components(adjacency_list &out, const G &adj_list,
+	const algo_options &options = algo_options()) {
+    trace_scope bridge_span("connect components");
     std::vector<std::vector<node>> components = get_components(out);
     
     if (components.size() > 1) {
-        connect_components(out, components, adj_list);
+        const edge_list bridges = connect_components(out, components, adj_list,
+		options.time_limit);
+
+	if (options.bridges != nullptr) {
+	    options.bridges->insert(options.bridges->end(), bridges.begin(), bridges.end());
+	} else if (options.writer != nullptr) {
+	    options.writer->push(bridges);
+	}
     }
+}
+
+// The main algorithm routine, driver of everything here.
+// Partitions nodes, then runs the graphlet propagation from the maximum
+// degree node in each partition. Connects components at the end, if possible
+template <typename G>
+adjacency_list algo_routine(const G &adj_list, const int threads,
+	const algo_options &options = algo_options()) {
+    adjacency_list out;
+    out.reserve(num_nodes(adj_list));
+
+    for_each_node(adj_list, [&](const node key_node) {
+        add_node(out, key_node, get_degree(adj_list, key_node));
+    });
+    const size_t num_partitions = options.num_partitions > 0 ? options.num_partitions : threads;
+    uint64_t span_start = trace_start();
+    std::vector<partition_view<G>> partitions = partition_nodes(adj_list, num_partitions,
+	    options.seed);
+    trace_complete("partition build", span_start);
+
+    std::vector<size_t> indices(partitions.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    propagate_partitions(partitions, indices, out, threads, options);
+    
+    bridge_components(out, adj_list, options);
     
     return out;
 }
+
+// Updates a previous result after the input graph changed by a delta of
+// inserted and deleted edges, without rerunning the whole algorithm.
+// adj_list and prev_result are modified in place, prev_result becomes the
+// new result.
+//
+// The region touched by the delta (endpoints of changed edges and their
+// adjacents) has all of its result edges released, so it is disjoint from
+// the rest of the result. Propagation is rerun on just the region and each
+// of its new components is bridged back with single edges, which keeps the
+// result planar. The work done depends on the size of the region rather
+// than the size of the graph
+void update_routine(adjacency_list &adj_list, adjacency_list &prev_result,
+	const edge_list &inserted, const edge_list &deleted) {
+    std::unordered_set<node> touched;
+
+    for (std::pair<node, node> edge : deleted) {
+	remove_edge(adj_list, edge.first, edge.second);
+	remove_edge(prev_result, edge.first, edge.second);
+	touched.insert(edge.first);
+	touched.insert(edge.second);
+    }
+
+    for (std::pair<node, node> edge : inserted) {
+	if (edge.first != edge.second) {
+	    add_edge(adj_list, edge.first, edge.second);
+	    touched.insert(edge.first);
+	    touched.insert(edge.second);
+	}
+    }
+
+    std::unordered_set<node> region;
+    for (node this_node : touched) {
+	std::vector<node> &adjs = adj_list[this_node];
+	// inserted edges may have left duplicates or unsorted adjacents
+	std::sort(adjs.begin(), adjs.end());
+	adjs.erase(std::unique(adjs.begin(), adjs.end()), adjs.end());
+
+	region.insert(this_node);
+	region.insert(adjs.begin(), adjs.end());
+    }
+
+    // nodes that had no edges in the previous result may be missing from it
+    for (node this_node : region) {
+	add_node(prev_result, this_node, 0);
+    }
+
+    // release every result edge incident to the region. Nodes outside the
+    // region that are left without any edges are pulled into it
+    std::vector<node> boundary;
+    for (node this_node : region) {
+	for (node adj : prev_result.at(this_node)) {
+	    if (region.find(adj) == region.end()) {
+		std::vector<node> &adj_adjs = prev_result.at(adj);
+		adj_adjs.erase(std::remove(adj_adjs.begin(), adj_adjs.end(), this_node),
+			adj_adjs.end());
+		if (adj_adjs.empty()) {
+		    boundary.push_back(adj);
+		}
+	    }
+	}
+	prev_result.at(this_node).clear();
+    }
+    region.insert(boundary.begin(), boundary.end());
+
+    if (region.empty()) {
+	return;
+    }
+
+    adjacency_list local_graph;
+    for (node this_node : region) {
+	add_node(local_graph, this_node, 0);
+	for (node adj : adj_list.at(this_node)) {
+	    if (this_node < adj && region.find(adj) != region.end()) {
+		add_edge(local_graph, this_node, adj);
+	    }
+	}
+    }
+
+    const std::vector<node> edges = propagate_graph(local_graph, algo_options(), 0);
+    for (size_t idx = 0; idx < edges.size(); idx += 2) {
+	add_edge(prev_result, edges.at(idx), edges.at(idx + 1));
+    }
+
+    // find the components of the rebuilt region, index 0 stands for
+    // everything outside of it
+    std::unordered_map<node, size_t> node_to_comp;
+    std::vector<std::vector<node>> components;
+    for (node this_node : region) {
+	if (node_to_comp.find(this_node) == node_to_comp.end()) {
+	    components.push_back(node_bfs(this_node, prev_result));
+	    for (node comp_node : components.back()) {
+		node_to_comp.insert({comp_node, components.size()});
+	    }
+	}
+    }
+
+    disjoint_sets comp_sets = make_disjoint_sets(components.size() + 1);
+    edge_list bridges;
+
+    // first bridge components straight to the rest of the result, then to
+    // each other, never joining two that are already connected
+    for (bool to_outside : {true, false}) {
+	for (size_t idx = 0; idx < components.size(); idx++) {
+	    bool bridged = false;
+	    for (node node_0 : components.at(idx)) {
+		for (node node_1 : adj_list.at(node_0)) {
+		    auto search = node_to_comp.find(node_1);
+		    const size_t node_1_comp = search == node_to_comp.end() ? 0 : search->second;
+
+		    if ((node_1_comp == 0) == to_outside &&
+			    union_sets(comp_sets, idx + 1, node_1_comp)) {
+			bridges.push_back(std::make_pair(node_0, node_1));
+			bridged = true;
+			break;
+		    }
+		}
+		if (bridged) {break;}
+	    }
+	}
+    }
+
+    for (std::pair<node, node> edge : bridges) {
+	add_edge(prev_result, edge.first, edge.second);
+    }
+}
+
+#endif
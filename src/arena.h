@@ -0,0 +1,71 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#define ARENA_BLOCK_SIZE (1 << 20)
+
+// A bump allocator for short lived scratch data, used through std::pmr
+// containers. Memory is handed out from large blocks and is only reclaimed
+// all at once by reset, which keeps the blocks around for reuse. Once the
+// blocks are big enough for the work between resets, allocating from the
+// arena never touches the heap
+class scratch_arena : public std::pmr::memory_resource {
+public:
+    // Makes all of the memory available again, invalidating everything
+    // allocated since the last reset
+    void reset() {
+	current_block = 0;
+	offset = 0;
+    }
+
+    size_t num_blocks() const {
+	return blocks.size();
+    }
+
+private:
+    std::vector<std::pair<std::unique_ptr<std::byte[]>, size_t>> blocks;
+    size_t current_block = 0;
+    size_t offset = 0;
+
+    void *do_allocate(size_t bytes, size_t alignment) override {
+	while (current_block < blocks.size()) {
+	    std::byte *base = blocks[current_block].first.get();
+	    const size_t aligned = (reinterpret_cast<size_t>(base) + offset + alignment - 1) /
+		alignment * alignment - reinterpret_cast<size_t>(base);
+
+	    if (aligned + bytes <= blocks[current_block].second) {
+		offset = aligned + bytes;
+		return base + aligned;
+	    }
+
+	    current_block++;
+	    offset = 0;
+	}
+
+	const size_t block_size = std::max((size_t) ARENA_BLOCK_SIZE, bytes + alignment);
+	blocks.push_back(std::make_pair(std::make_unique<std::byte[]>(block_size), block_size));
+	current_block = blocks.size() - 1;
+	offset = 0;
+
+	return do_allocate(bytes, alignment);
+    }
+
+    // memory is only given back by reset
+    void do_deallocate(void *, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+	return this == &other;
+    }
+};
+
+// Gets the calling thread's scratch arena
+scratch_arena &get_scratch_arena() {
+    thread_local scratch_arena arena;
+    return arena;
+}
+
+#endif
@@ -0,0 +1,257 @@
+#ifndef BLOCKS_H
+#define BLOCKS_H
+
+#include "algo.h"
+
+// Biconnected block decomposition. A graph is planar if and only if all of
+// its blocks are, and blocks only share articulation points, so planar
+// blocks can be kept whole and the algorithm only needs to run on the
+// non-planar ones. Gluing planar graphs together at single nodes keeps them
+// planar, so the block results can simply be combined
+
+// A block of the graph with its nodes relabeled 0..n-1, so that small
+// blocks stay small. nodes maps the local ids back to the graph
+struct graph_block {
+    std::vector<node> nodes;
+    adjacency_list adj_list;
+};
+
+// One step of the DFS in find_blocks, standing in for a recursive call
+struct dfs_frame {
+    node current_node;
+    node parent;
+    size_t adj_idx;
+};
+
+// Finds the blocks of the connected component containing start_node, with
+// Hopcroft-Tarjan lowpoints. The DFS uses an explicit stack so that deep
+// graphs can't overflow the call stack. Each block is returned as the list
+// of its edges
+std::vector<edge_list> find_blocks(const node start_node, const adjacency_list &adj_list) {
+    std::vector<edge_list> blocks;
+    std::unordered_map<node, size_t> discovered;
+    std::unordered_map<node, size_t> low;
+    std::vector<dfs_frame> frames;
+    edge_list edge_stack;
+    size_t time = 0;
+
+    discovered[start_node] = time;
+    low[start_node] = time;
+    time++;
+    frames.push_back({start_node, start_node, 0});
+
+    while (!frames.empty()) {
+	dfs_frame &frame = frames.back();
+	const node current_node = frame.current_node;
+	const std::vector<node> &adjs = adj_list.at(current_node);
+
+	if (frame.adj_idx < adjs.size()) {
+	    const node adj = adjs.at(frame.adj_idx);
+	    frame.adj_idx++;
+
+	    if (adj == frame.parent && frames.size() > 1) {
+		continue;
+	    }
+
+	    auto search = discovered.find(adj);
+	    if (search == discovered.end()) {
+		edge_stack.push_back(std::make_pair(current_node, adj));
+		discovered[adj] = time;
+		low[adj] = time;
+		time++;
+		// frame is invalidated here
+		frames.push_back({adj, current_node, 0});
+	    } else if (search->second < discovered.at(current_node)) {
+		// back edge to an ancestor
+		edge_stack.push_back(std::make_pair(current_node, adj));
+		low.at(current_node) = std::min(low.at(current_node), search->second);
+	    }
+	} else {
+	    const node parent = frame.parent;
+	    frames.pop_back();
+
+	    if (!frames.empty()) {
+		low.at(parent) = std::min(low.at(parent), low.at(current_node));
+
+		// parent is an articulation point, or the root, so everything
+		// above the tree edge to current_node is one block
+		if (low.at(current_node) >= discovered.at(parent)) {
+		    edge_list block;
+		    std::pair<node, node> edge;
+		    do {
+			edge = edge_stack.back();
+			edge_stack.pop_back();
+			block.push_back(edge);
+		    } while (edge.first != parent || edge.second != current_node);
+		    blocks.push_back(std::move(block));
+		}
+	    }
+	}
+    }
+
+    return blocks;
+}
+
+// Builds the relabeled block from its edges
+graph_block make_block(const edge_list &edges) {
+    graph_block block;
+    std::unordered_map<node, node> local_ids;
+
+    auto local_id = [&](const node key_node) {
+	auto search = local_ids.find(key_node);
+	if (search != local_ids.end()) {
+	    return search->second;
+	}
+	const node id = block.nodes.size();
+	local_ids.insert({key_node, id});
+	block.nodes.push_back(key_node);
+	return id;
+    };
+
+    for (std::pair<node, node> edge : edges) {
+	add_edge(block.adj_list, local_id(edge.first), local_id(edge.second));
+    }
+
+    return block;
+}
+
+// Runs the algorithm block by block. Blocks are found in parallel for each
+// connected component, then blocks that can't be planar from their sizes
+// alone are tested in parallel. Planar blocks are kept whole. Non-planar
+// blocks are scheduled largest first: ones big enough to keep every thread
+// busy get all of the threads, the rest run in parallel with one thread each
+adjacency_list block_routine(const adjacency_list &adj_list, const int threads,
+	const algo_options &options = algo_options()) {
+    adjacency_list out;
+    out.reserve(adj_list.size());
+
+    for (auto &[key_node, adjs] : adj_list) {
+	add_node(out, key_node, adjs.size());
+    }
+
+    const std::vector<std::vector<node>> components = get_components(adj_list);
+    std::vector<std::vector<edge_list>> component_blocks(components.size());
+
+#pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+    for (size_t idx = 0; idx < components.size(); idx++) {
+	component_blocks.at(idx) = find_blocks(components.at(idx).front(), adj_list);
+    }
+
+    std::vector<edge_list> blocks;
+    for (std::vector<edge_list> &these_blocks : component_blocks) {
+	for (edge_list &block : these_blocks) {
+	    blocks.push_back(std::move(block));
+	}
+    }
+    std::vector<std::vector<edge_list>>().swap(component_blocks);
+
+    std::sort(blocks.begin(), blocks.end(), [](const edge_list &a, const edge_list &b) {
+	return a.size() > b.size();
+    });
+
+    std::vector<graph_block> nonplanar_blocks;
+    std::vector<char> planar(blocks.size(), 1);
+
+    // blocks under 9 edges are always planar (K3,3 has 9, K5 has 10)
+    size_t num_candidates = 0;
+    while (num_candidates < blocks.size() && blocks.at(num_candidates).size() >= 9) {
+	num_candidates++;
+    }
+
+#pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+    for (size_t idx = 0; idx < num_candidates; idx++) {
+	planar.at(idx) = boyer_myrvold_test(make_block(blocks.at(idx)).adj_list);
+    }
+
+    size_t nonplanar_edges = 0;
+    for (size_t idx = 0; idx < blocks.size(); idx++) {
+	if (planar.at(idx)) {
+	    for (std::pair<node, node> edge : blocks.at(idx)) {
+		add_edge(out, edge.first, edge.second);
+	    }
+	    if (options.writer != nullptr) {
+		options.writer->push(blocks.at(idx));
+	    }
+	} else {
+	    nonplanar_edges += blocks.at(idx).size();
+	    nonplanar_blocks.push_back(make_block(blocks.at(idx)));
+	}
+	edge_list().swap(blocks.at(idx));
+    }
+
+    // block results use local ids, so they are mapped back here instead of
+    // going through the writer. The block's bridges are held back along
+    // with the others if options asks for them
+    algo_options block_options;
+    block_options.time_limit = options.time_limit;
+
+    auto add_block_result = [&](const graph_block &block, const adjacency_list &result,
+	    const edge_list &block_bridges) {
+	std::unordered_set<std::pair<node, node>, edge_hash> held;
+	if (options.bridges != nullptr) {
+	    for (std::pair<node, node> edge : block_bridges) {
+		const std::pair<node, node> global = std::make_pair(block.nodes.at(edge.first),
+			block.nodes.at(edge.second));
+		held.insert(std::minmax(global.first, global.second));
+		options.bridges->push_back(global);
+	    }
+	}
+
+	edge_list edges;
+	for (auto &[key_node, adjs] : result) {
+	    for (node adj : adjs) {
+		if (key_node < adj) {
+		    edges.push_back(std::make_pair(block.nodes.at(key_node), block.nodes.at(adj)));
+		}
+	    }
+	}
+	for (std::pair<node, node> edge : edges) {
+	    add_edge(out, edge.first, edge.second);
+	}
+	if (options.writer != nullptr) {
+	    edges.erase(std::remove_if(edges.begin(), edges.end(), [&](std::pair<node, node> edge) {
+		return held.count(std::minmax(edge.first, edge.second)) > 0;
+	    }), edges.end());
+	    options.writer->push(edges);
+	}
+    };
+
+    size_t num_large = 0;
+    while (num_large < nonplanar_blocks.size() &&
+	    num_edges(nonplanar_blocks.at(num_large).adj_list) * threads >= nonplanar_edges) {
+	const graph_block &block = nonplanar_blocks.at(num_large);
+	edge_list block_bridges;
+	algo_options large_options = block_options;
+	large_options.bridges = &block_bridges;
+	// a block can hold most of the edges with fewer nodes than threads
+	const int block_threads = std::min<size_t>(threads, block.nodes.size());
+	const adjacency_list result = algo_routine(block.adj_list, block_threads, large_options);
+	add_block_result(block, result, block_bridges);
+	num_large++;
+    }
+
+#pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+    for (size_t idx = num_large; idx < nonplanar_blocks.size(); idx++) {
+	const graph_block &block = nonplanar_blocks.at(idx);
+	edge_list block_bridges;
+	algo_options small_options = block_options;
+	small_options.bridges = &block_bridges;
+	const adjacency_list result = algo_routine(block.adj_list, 1, small_options);
+
+#pragma omp critical(block_out)
+	add_block_result(block, result, block_bridges);
+    }
+
+    // nodes left without edges weren't reached, apart from isolated ones
+    if (options.nodes_covered != nullptr) {
+	for (auto &[key_node, adjs] : out) {
+	    if (!adjs.empty() || adj_list.at(key_node).empty()) {
+		(*options.nodes_covered)++;
+	    }
+	}
+    }
+
+    return out;
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "utils.h"
+
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <unistd.h>
+
+// On-disk cache of results. Entries are keyed on a hash of the input file
+// contents combined with the options that affect the result, so reruns on
+// unchanged inputs can skip the algorithm entirely
+
+// Builds the cache key from the input hash and a description of the
+// options that affect the output
+std::string cache_key(const uint64_t input_hash, const std::string &options) {
+    uint64_t hash = hash_line(options, input_hash);
+
+    std::stringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return key.str();
+}
+
+std::filesystem::path cache_entry_path(const std::string &cache_dir, const std::string &key) {
+    return std::filesystem::path(cache_dir) / (key + ".edges");
+}
+
+// If there is a cached result for the key, copies it to output_path.
+// Returns whether there was a hit
+bool cache_lookup(const std::string &cache_dir, const std::string &key,
+	const std::string &output_path) {
+    const std::filesystem::path entry = cache_entry_path(cache_dir, key);
+    std::error_code err;
+
+    if (!std::filesystem::is_regular_file(entry, err)) {
+	return false;
+    }
+
+    std::filesystem::copy_file(entry, output_path,
+	    std::filesystem::copy_options::overwrite_existing, err);
+
+    return !err;
+}
+
+// Stores the result at output_path in the cache. The entry is copied to a
+// temporary file first and renamed, so concurrent runs never see a partial
+// entry. Returns whether the entry was stored
+bool cache_store(const std::string &cache_dir, const std::string &key,
+	const std::string &output_path) {
+    const std::filesystem::path entry = cache_entry_path(cache_dir, key);
+    std::filesystem::path temp_entry = entry;
+    temp_entry += ".tmp." + std::to_string(getpid());
+    std::error_code err;
+
+    std::filesystem::create_directories(cache_dir, err);
+    if (err) {
+	return false;
+    }
+
+    std::filesystem::copy_file(output_path, temp_entry,
+	    std::filesystem::copy_options::overwrite_existing, err);
+    if (err) {
+	return false;
+    }
+
+    std::filesystem::rename(temp_entry, entry, err);
+
+    return !err;
+}
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef COMPRESSED_GRAPH_H
+#define COMPRESSED_GRAPH_H
+
+#include "utils.h"
+
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+
+// A read-only graph representation where the sorted adjacents of every node
+// are delta-encoded as byte varints in one contiguous buffer, similar to
+// Ligra+. Each node's block starts with its degree, then the first adjacent
+// as a zigzag encoded offset from the node itself, then gaps between
+// consecutive adjacents. Node ids are kept sorted so lookups are a binary
+// search instead of a hash
+struct compressed_graph {
+    std::vector<node> ids;
+    std::vector<size_t> offsets;
+    std::vector<uint8_t> bytes;
+};
+
+// Writes a value as an unsigned LEB128 varint
+void write_varint(std::vector<uint8_t> &bytes, uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back((uint8_t) value);
+}
+
+// Reads an unsigned LEB128 varint, advancing ptr past it
+uint64_t read_varint(const uint8_t *&ptr) {
+    uint64_t value = *ptr & 0x7f;
+    size_t shift = 7;
+
+    while (*ptr++ & 0x80) {
+        value |= (uint64_t) (*ptr & 0x7f) << shift;
+        shift += 7;
+    }
+
+    return value;
+}
+
+// Sequentially decodes the adjacents of a single node
+struct compressed_adjs_iterator {
+    typedef std::forward_iterator_tag iterator_category;
+    typedef node value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const node *pointer;
+    typedef node reference;
+
+    const uint8_t *ptr = nullptr;
+    size_t remaining = 0;
+    node current = 0;
+
+    node operator*() const { return current; }
+
+    compressed_adjs_iterator &operator++() {
+        if (--remaining > 0) {
+            current += read_varint(ptr);
+        }
+        return *this;
+    }
+
+    compressed_adjs_iterator operator++(int) {
+        compressed_adjs_iterator prev = *this;
+        ++(*this);
+        return prev;
+    }
+
+    // iterators over the same block only differ by how much is left
+    bool operator==(const compressed_adjs_iterator &other) const {
+        return remaining == other.remaining;
+    }
+
+    bool operator!=(const compressed_adjs_iterator &other) const {
+        return remaining != other.remaining;
+    }
+};
+
+// The adjacents of a node, iterable with a range-based for loop
+struct compressed_adjs {
+    compressed_adjs_iterator first;
+
+    compressed_adjs_iterator begin() const { return first; }
+    compressed_adjs_iterator end() const { return compressed_adjs_iterator(); }
+    size_t size() const { return first.remaining; }
+    bool empty() const { return first.remaining == 0; }
+};
+
+// Compresses an adjacency list. Adjacents do not need to be sorted or
+// deduplicated beforehand
+compressed_graph compress(const adjacency_list &adj_list) {
+    compressed_graph graph;
+    graph.ids.reserve(adj_list.size());
+
+    for (auto &[key_node, _adjs] : adj_list) {
+        graph.ids.push_back(key_node);
+    }
+    std::sort(graph.ids.begin(), graph.ids.end());
+
+    graph.offsets.reserve(graph.ids.size() + 1);
+    std::vector<node> adjs;
+
+    for (node key_node : graph.ids) {
+        graph.offsets.push_back(graph.bytes.size());
+
+        adjs = adj_list.at(key_node);
+        std::sort(adjs.begin(), adjs.end());
+        adjs.erase(std::unique(adjs.begin(), adjs.end()), adjs.end());
+
+        write_varint(graph.bytes, adjs.size());
+
+        if (!adjs.empty()) {
+            int64_t first_offset = (int64_t) adjs.front() - (int64_t) key_node;
+            write_varint(graph.bytes, ((uint64_t) first_offset << 1) ^
+                         (uint64_t) (first_offset >> 63));
+
+            for (size_t idx = 1; idx < adjs.size(); idx++) {
+                write_varint(graph.bytes, adjs.at(idx) - adjs.at(idx - 1));
+            }
+        }
+    }
+    graph.offsets.push_back(graph.bytes.size());
+    graph.bytes.shrink_to_fit();
+
+    return graph;
+}
+
+// Gets the position of a node in the compressed graph, throws
+// std::out_of_range like adjacency_list::at if it is not present
+size_t node_index(const compressed_graph &graph, const node key_node) {
+    auto search = std::lower_bound(graph.ids.begin(), graph.ids.end(), key_node);
+    if (search == graph.ids.end() || *search != key_node) {
+        throw std::out_of_range("node not in compressed_graph");
+    }
+    return search - graph.ids.begin();
+}
+
+// Gets the adjacents of a node, decoded lazily while iterating
+compressed_adjs get_adjs(const compressed_graph &graph, const node key_node) {
+    const size_t idx = node_index(graph, key_node);
+    compressed_adjs adjs;
+    adjs.first.ptr = &graph.bytes.at(graph.offsets.at(idx));
+    adjs.first.remaining = read_varint(adjs.first.ptr);
+
+    if (adjs.first.remaining > 0) {
+        uint64_t zigzag = read_varint(adjs.first.ptr);
+        int64_t first_offset = (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+        adjs.first.current = (node) ((int64_t) key_node + first_offset);
+    }
+
+    return adjs;
+}
+
+size_t get_degree(const compressed_graph &graph, const node key_node) {
+    const uint8_t *ptr = &graph.bytes.at(graph.offsets.at(node_index(graph, key_node)));
+    return read_varint(ptr);
+}
+
+size_t num_nodes(const compressed_graph &graph) {
+    return graph.ids.size();
+}
+
+template <typename F>
+void for_each_node(const compressed_graph &graph, F func) {
+    for (node key_node : graph.ids) {
+        func(key_node);
+    }
+}
+
+// Number of bytes held by the compressed representation
+size_t size_in_bytes(const compressed_graph &graph) {
+    return graph.ids.size() * sizeof(node) + graph.offsets.size() * sizeof(size_t) +
+        graph.bytes.size();
+}
+
+// Builds a graph of type G from an adjacency list, used where the algorithm
+// needs to materialize new graphs of the same representation as its input
+template <typename G>
+G build_graph(adjacency_list &&adj_list);
+
+template <>
+adjacency_list build_graph(adjacency_list &&adj_list) {
+    return std::move(adj_list);
+}
+
+template <>
+compressed_graph build_graph(adjacency_list &&adj_list) {
+    compressed_graph graph = compress(adj_list);
+    adjacency_list().swap(adj_list);
+    return graph;
+}
+
+#endif
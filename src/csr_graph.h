@@ -0,0 +1,193 @@
+#ifndef CSR_GRAPH_H
+#define CSR_GRAPH_H
+
+#include "compressed_graph.h"
+
+#include <memory>
+#include <stdexcept>
+
+// A read-only graph over compressed sparse row arrays, such as the indptr
+// and indices of a SciPy sparse matrix, so the algorithm can run on arrays
+// owned by someone else without copying them. Nodes are the rows 0..n-1,
+// the adjacents of row r are indices[indptr[r]] to indices[indptr[r + 1] - 1].
+// The arrays have to be a simple undirected graph, symmetric without self
+// loops or duplicates, which is_simple_csr checks. Graphs built by make_csr
+// and build_graph own their arrays instead
+template <typename I>
+struct csr_graph {
+    const I *indptr = nullptr;
+    const I *indices = nullptr;
+    size_t num_rows = 0;
+    // the arrays, when the graph owns them
+    std::shared_ptr<const std::vector<I>> owned_indptr;
+    std::shared_ptr<const std::vector<I>> owned_indices;
+    // the rows that are nodes, when not all of them are
+    std::shared_ptr<const std::vector<node>> rows;
+};
+
+// The adjacents of a node, read straight from indices
+template <typename I>
+struct csr_adjs {
+    const I *first;
+    const I *last;
+
+    const I *begin() const { return first; }
+    const I *end() const { return last; }
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+};
+
+template <typename I>
+csr_adjs<I> get_adjs(const csr_graph<I> &graph, const node key_node) {
+    if (key_node >= graph.num_rows) {
+        throw std::out_of_range("node not in csr_graph");
+    }
+    return csr_adjs<I> {graph.indices + graph.indptr[key_node],
+        graph.indices + graph.indptr[key_node + 1]};
+}
+
+template <typename I>
+size_t get_degree(const csr_graph<I> &graph, const node key_node) {
+    return get_adjs(graph, key_node).size();
+}
+
+template <typename I>
+size_t num_nodes(const csr_graph<I> &graph) {
+    return graph.rows ? graph.rows->size() : graph.num_rows;
+}
+
+template <typename I, typename F>
+void for_each_node(const csr_graph<I> &graph, F func) {
+    if (graph.rows) {
+        for (node key_node : *graph.rows) {
+            func(key_node);
+        }
+        return;
+    }
+    for (node key_node = 0; key_node < graph.num_rows; key_node++) {
+        func(key_node);
+    }
+}
+
+// Tests whether CSR arrays with num_rows rows are a simple undirected graph
+// that csr_graph can read in place: in range, every row sorted without
+// duplicates or self loops, and every edge stored in both directions
+template <typename I>
+bool is_simple_csr(const I *indptr, const I *indices, const size_t num_rows,
+        const size_t num_indices) {
+    if (indptr[0] != 0 || (size_t) indptr[num_rows] != num_indices) {
+        return false;
+    }
+    for (size_t row = 0; row < num_rows; row++) {
+        if (indptr[row + 1] < indptr[row]) {
+            return false;
+        }
+    }
+
+    for (size_t row = 0; row < num_rows; row++) {
+        for (I idx = indptr[row]; idx < indptr[row + 1]; idx++) {
+            const I col = indices[idx];
+            if (col < 0 || (size_t) col >= num_rows || (size_t) col == row ||
+                    (idx > indptr[row] && col <= indices[idx - 1])) {
+                return false;
+            }
+            if (!std::binary_search(indices + indptr[col], indices + indptr[col + 1], (I) row)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Builds a graph that owns its arrays from num_pairs edges on the nodes
+// below num_rows, with get_edge(idx) giving the endpoints of each. Edges
+// are added in both directions, self loops and duplicates are dropped
+template <typename I, typename F>
+csr_graph<I> make_csr(const size_t num_rows, const size_t num_pairs, F get_edge) {
+    std::vector<I> indptr(num_rows + 1, 0);
+    for (size_t idx = 0; idx < num_pairs; idx++) {
+        const std::pair<node, node> edge = get_edge(idx);
+        if (edge.first != edge.second) {
+            indptr.at(edge.first + 1)++;
+            indptr.at(edge.second + 1)++;
+        }
+    }
+    for (size_t row = 0; row < num_rows; row++) {
+        indptr[row + 1] += indptr[row];
+    }
+
+    std::vector<I> indices(indptr.back());
+    std::vector<I> next(indptr.begin(), indptr.end() - 1);
+    for (size_t idx = 0; idx < num_pairs; idx++) {
+        const std::pair<node, node> edge = get_edge(idx);
+        if (edge.first != edge.second) {
+            indices[next[edge.first]++] = (I) edge.second;
+            indices[next[edge.second]++] = (I) edge.first;
+        }
+    }
+
+    // sorts and deduplicates each row, moving it down over the duplicates
+    // removed from the rows before it
+    I write = 0;
+    for (size_t row = 0; row < num_rows; row++) {
+        I *first = indices.data() + indptr[row];
+        I *last = indices.data() + indptr[row + 1];
+        std::sort(first, last);
+        last = std::unique(first, last);
+        indptr[row] = write;
+        write = std::copy(first, last, indices.data() + write) - indices.data();
+    }
+    indptr[num_rows] = write;
+    indices.resize(write);
+    indices.shrink_to_fit();
+
+    csr_graph<I> graph;
+    graph.num_rows = num_rows;
+    graph.owned_indptr = std::make_shared<const std::vector<I>>(std::move(indptr));
+    graph.owned_indices = std::make_shared<const std::vector<I>>(std::move(indices));
+    graph.indptr = graph.owned_indptr->data();
+    graph.indices = graph.owned_indices->data();
+    return graph;
+}
+
+// Builds a csr_graph from an adjacency list, for the graphs the algorithm
+// materializes. Rows go up to the largest node id, only the nodes in the
+// adjacency list are nodes of the graph
+template <typename I>
+csr_graph<I> build_csr_graph(adjacency_list &&adj_list) {
+    auto nodes = std::make_shared<std::vector<node>>();
+    nodes->reserve(adj_list.size());
+    size_t num_adjs = 0;
+    for (auto &[key_node, adjs] : adj_list) {
+        nodes->push_back(key_node);
+        num_adjs += adjs.size();
+    }
+    std::sort(nodes->begin(), nodes->end());
+
+    edge_list edges;
+    edges.reserve(num_adjs);
+    for (node key_node : *nodes) {
+        for (node adj : adj_list.at(key_node)) {
+            edges.push_back(std::make_pair(key_node, adj));
+        }
+    }
+    adjacency_list().swap(adj_list);
+
+    const size_t num_rows = nodes->empty() ? 0 : nodes->back() + 1;
+    csr_graph<I> graph = make_csr<I>(num_rows, edges.size(),
+            [&](const size_t idx) { return edges[idx]; });
+    graph.rows = std::move(nodes);
+    return graph;
+}
+
+template <>
+csr_graph<int32_t> build_graph(adjacency_list &&adj_list) {
+    return build_csr_graph<int32_t>(std::move(adj_list));
+}
+
+template <>
+csr_graph<int64_t> build_graph(adjacency_list &&adj_list) {
+    return build_csr_graph<int64_t>(std::move(adj_list));
+}
+
+#endif
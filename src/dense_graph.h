@@ -0,0 +1,121 @@
+#ifndef DENSE_GRAPH_H
+#define DENSE_GRAPH_H
+
+#include "utils.h"
+
+#include <cstdint>
+
+// Graphs with at most this many nodes are searched through a dense_graph.
+// At the limit the bit matrix takes 2 MiB
+#define DENSE_GRAPH_MAX_NODES 4096
+
+// A read-only graph representation for small graphs, with nodes relabeled
+// 0..n-1 and an n x n adjacency bit matrix, so edge tests are a single bit
+// test and neighbourhoods can be intersected a word at a time. The adjacents
+// are also kept as lists, in the order of the source graph, for iterating
+struct dense_graph {
+    // maps the local ids back to the source graph
+    std::vector<node> ids;
+    std::vector<std::vector<node>> adjs;
+    // words in each row of the matrix
+    size_t words = 0;
+    std::vector<uint64_t> bits;
+};
+
+// A set of local ids of a dense_graph, one bit per node
+typedef std::vector<uint64_t> dense_set;
+
+bool test_bit(const uint64_t *row, const node key_node) {
+    return (row[key_node / 64] >> (key_node % 64)) & 1;
+}
+
+void set_bit(uint64_t *row, const node key_node) {
+    row[key_node / 64] |= (uint64_t) 1 << (key_node % 64);
+}
+
+void clear_bit(uint64_t *row, const node key_node) {
+    row[key_node / 64] &= ~((uint64_t) 1 << (key_node % 64));
+}
+
+// Gets the row of the adjacency matrix of a node
+const uint64_t *dense_row(const dense_graph &graph, const node key_node) {
+    return graph.bits.data() + key_node * graph.words;
+}
+
+bool has_edge(const dense_graph &graph, const node node_0, const node node_1) {
+    return test_bit(dense_row(graph, node_0), node_1);
+}
+
+// Tests whether three sets share a node, a word at a time
+bool any_common(const uint64_t *row_0, const uint64_t *row_1, const uint64_t *row_2,
+        const size_t words) {
+    for (size_t idx = 0; idx < words; idx++) {
+        if (row_0[idx] & row_1[idx] & row_2[idx]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Counts the nodes in a set
+size_t count_bits(const uint64_t *row, const size_t words) {
+    size_t count = 0;
+    for (size_t idx = 0; idx < words; idx++) {
+        count += __builtin_popcountll(row[idx]);
+    }
+    return count;
+}
+
+// Builds the dense representation of any graph. Local ids follow the order
+// of for_each_node on the source graph, so picking start nodes by iterating
+// over either gives the same node
+template <typename G>
+dense_graph make_dense(const G &source) {
+    dense_graph graph;
+    std::unordered_map<node, node> local_ids;
+    local_ids.reserve(num_nodes(source));
+
+    for_each_node(source, [&](const node key_node) {
+        local_ids.insert({key_node, graph.ids.size()});
+        graph.ids.push_back(key_node);
+    });
+
+    graph.words = (graph.ids.size() + 63) / 64;
+    graph.bits.assign(graph.ids.size() * graph.words, 0);
+    graph.adjs.resize(graph.ids.size());
+
+    for (node local_node = 0; local_node < graph.ids.size(); local_node++) {
+        uint64_t *row = graph.bits.data() + local_node * graph.words;
+        std::vector<node> &adjs = graph.adjs.at(local_node);
+        adjs.reserve(get_degree(source, graph.ids.at(local_node)));
+
+        for (node adj : get_adjs(source, graph.ids.at(local_node))) {
+            const node local_adj = local_ids.at(adj);
+            adjs.push_back(local_adj);
+            set_bit(row, local_adj);
+        }
+    }
+
+    return graph;
+}
+
+const std::vector<node> &get_adjs(const dense_graph &graph, const node key_node) {
+    return graph.adjs.at(key_node);
+}
+
+size_t get_degree(const dense_graph &graph, const node key_node) {
+    return graph.adjs.at(key_node).size();
+}
+
+size_t num_nodes(const dense_graph &graph) {
+    return graph.ids.size();
+}
+
+template <typename F>
+void for_each_node(const dense_graph &graph, F func) {
+    for (node key_node = 0; key_node < graph.ids.size(); key_node++) {
+        func(key_node);
+    }
+}
+
+#endif
@@ -1,6 +1,14 @@
 #include "algo.h"
+#include "blocks.h"
+#include "cache.h"
+#include "peel.h"
+#include "portfolio.h"
+#include "repair.h"
+#include "stream.h"
+#include "tune.h"
 
 #include <chrono>
+#include <map>
 #include <stdlib.h>
 #include <version.h>
 
@@ -13,22 +21,28 @@
 #include "boost/log/utility/setup/console.hpp"
 #include "boost/log/utility/setup/file.hpp"
 
-// Initializes the logger
-void log_init() {
+// Initializes the logger. Console logging goes to stderr if stdout is
+// used for output
+void log_init(const bool output_to_stdout) {
       std::string log_format = "[%TimeStamp%] [%Severity%] [%Message%]";
       std::string log_path = "planarity_filter.log";
       boost::log::add_file_log(log_path, boost::log::keywords::format = log_format,
                                boost::log::keywords::open_mode = std::ios_base::app);
-      boost::log::add_console_log(std::cout, boost::log::keywords::format = log_format);
+      boost::log::add_console_log(output_to_stdout ? std::cerr : std::cout, 
+	      boost::log::keywords::format = log_format);
       boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::info);
       boost::log::add_common_attributes();
   }
 
 int main(int argc, char *argv[]) {
-    log_init();
-    
+    const auto run_start = std::chrono::steady_clock::now();
     int num_threads = 1;
     bool large_graph = false;
+    bool compressed = false;
+    bool blocks = false;
+    bool peel = false;
+    size_t portfolio_runs = 0;
+    size_t reservoir_size = STREAM_RESERVOIR_SIZE;
     size_t num_input_nodes = 100000000;
 
     // Get args
@@ -40,7 +54,23 @@ int main(int argc, char *argv[]) {
         ("output,o", po::value<std::string>()->required(), "output file path")
 	("threads,t", po::value<int>(&num_threads), "number of threads to use")
 	("large,l", "large graph flag, input must use unsigned ints for node identifiers")
-	("nodes,n", po::value<size_t>(&num_input_nodes), "number of nodes, use with large graph flag");
+	("nodes,n", po::value<size_t>(&num_input_nodes), "number of nodes, use with large graph flag")
+	("compressed,c", "run on a compressed copy of the input graph to reduce memory use")
+	("blocks", "split the graph into biconnected blocks first, keeping planar blocks whole")
+	("peel", "strip pendant trees and contract degree 2 chains before running, restoring them after")
+	("portfolio", po::value<size_t>(&portfolio_runs), "run this many differently configured runs in parallel and keep the best result")
+	("cache-dir", po::value<std::string>(), "directory for caching results of previous runs")
+	("delta", po::value<std::string>(), "edge delta file to update a previous result with, the input must be the previous input")
+	("previous-result", po::value<std::string>(), "previous result to update, use with delta")
+	("async-write", "write output from a background thread as it is computed, output may be - for stdout")
+	("profile", "log hardware performance counters for each phase and thread")
+	("pin-threads", "pin threads to cpus spread over the NUMA nodes, with partitions copied to each thread's node")
+	("time-limit", po::value<double>(), "wall clock budget in seconds, when it runs out the best planar subgraph found so far is returned")
+	("trace", po::value<std::string>(), "write a Chrome trace event timeline of each thread's work to this file")
+	("stream", "read the edges once, from a file or - for stdin, writing a planar subgraph as they arrive with O(n) memory")
+	("reservoir", po::value<size_t>(&reservoir_size), "number of rejected edges stream keeps to retry at the end")
+	("auto", "pick the number of threads and partitions from the graph's statistics and a measured per edge cost")
+	("calibration", po::value<std::string>(), "file to read the per edge cost for auto from, or to store it in if it has none");
 
     po::variables_map var_map;
 
@@ -60,10 +90,84 @@ int main(int argc, char *argv[]) {
         return 2;
     }
     
+    const bool async_write = var_map.count("async-write") > 0;
+    const bool profile = var_map.count("profile") > 0;
+    const bool pin_threads = var_map.count("pin-threads") > 0;
+    if (var_map.count("trace")) {
+	start_tracing();
+    }
+    const bool stream = var_map.count("stream") > 0;
+    log_init((async_write || stream) && var_map["output"].as<std::string>() == "-");
+
     if (var_map.count("large")) {
 	large_graph = true;
     } 
 
+    const bool incremental = var_map.count("delta") > 0;
+    if (incremental && (large_graph || !var_map.count("previous-result"))) {
+	std::cerr << "ERROR: delta requires previous-result and cannot be used with large\n";
+	std::cerr << desc << "\n";
+	return 1;
+    }
+
+    if (var_map.count("compressed")) {
+	compressed = true;
+    }
+
+    if (var_map.count("blocks")) {
+	blocks = true;
+    }
+
+    if (var_map.count("peel")) {
+	peel = true;
+    }
+
+    if (peel && incremental) {
+	std::cerr << "ERROR: peel cannot be used with delta\n";
+	std::cerr << desc << "\n";
+	return 1;
+    }
+
+    if (portfolio_runs > 0 && (blocks || compressed || incremental)) {
+	std::cerr << "ERROR: portfolio cannot be used with blocks, compressed or delta\n";
+	std::cerr << desc << "\n";
+	return 1;
+    }
+
+    if (stream && (large_graph || compressed || blocks || peel || portfolio_runs > 0 ||
+		incremental || async_write)) {
+	std::cerr << "ERROR: stream cannot be used with large, compressed, blocks, peel, "
+	    << "portfolio, delta or async-write\n";
+	std::cerr << desc << "\n";
+	return 1;
+    }
+
+    const bool auto_tune = var_map.count("auto") > 0;
+    if (auto_tune && (var_map.count("threads") || portfolio_runs > 0 || incremental || stream)) {
+	std::cerr << "ERROR: auto cannot be used with threads, portfolio, delta or stream\n";
+	std::cerr << desc << "\n";
+	return 1;
+    }
+
+    if (var_map.count("calibration") && !auto_tune) {
+	std::cerr << "ERROR: calibration requires auto\n";
+	std::cerr << desc << "\n";
+	return 1;
+    }
+
+    if (blocks && (compressed || incremental)) {
+	std::cerr << "ERROR: blocks cannot be used with compressed or delta\n";
+	std::cerr << desc << "\n";
+	return 1;
+    }
+
+    // the budget covers the whole run, but only the algorithm can stop early
+    deadline time_limit = NO_DEADLINE;
+    if (var_map.count("time-limit")) {
+	time_limit = run_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(var_map["time-limit"].as<double>()));
+    }
+
     // Log metadata about the run
     BOOST_LOG_TRIVIAL(info) << "#######################################";
     BOOST_LOG_TRIVIAL(info) << "New run, options listed below";
@@ -71,61 +175,445 @@ int main(int argc, char *argv[]) {
     BOOST_LOG_TRIVIAL(info) << "abbrev. commit hash: " << GIT_COMMIT_HASH;
     BOOST_LOG_TRIVIAL(info) << "Input: " << var_map["input"].as<std::string>();
     BOOST_LOG_TRIVIAL(info) << "Output: " << var_map["output"].as<std::string>();
-    BOOST_LOG_TRIVIAL(info) << "Num. threads: " << num_threads;
+    if (auto_tune) {
+	BOOST_LOG_TRIVIAL(info) << "Num. threads: auto";
+    } else {
+	BOOST_LOG_TRIVIAL(info) << "Num. threads: " << num_threads;
+    }
     BOOST_LOG_TRIVIAL(info) << "Large graph flag: " << large_graph;
+    BOOST_LOG_TRIVIAL(info) << "Compressed flag: " << compressed;
+    BOOST_LOG_TRIVIAL(info) << "Blocks flag: " << blocks;
+    BOOST_LOG_TRIVIAL(info) << "Peel flag: " << peel;
+    if (portfolio_runs > 0) {
+	BOOST_LOG_TRIVIAL(info) << "Portfolio runs: " << portfolio_runs;
+    }
+    BOOST_LOG_TRIVIAL(info) << "Stream flag: " << stream;
+    if (stream) {
+	BOOST_LOG_TRIVIAL(info) << "Reservoir size: " << reservoir_size;
+    }
+    BOOST_LOG_TRIVIAL(info) << "Async write flag: " << async_write;
+    BOOST_LOG_TRIVIAL(info) << "Profile flag: " << profile;
+    BOOST_LOG_TRIVIAL(info) << "Pin threads flag: " << pin_threads;
+    if (var_map.count("time-limit")) {
+	BOOST_LOG_TRIVIAL(info) << "Time limit: " << var_map["time-limit"].as<double>() << "s";
+    }
+    if (var_map.count("trace")) {
+	BOOST_LOG_TRIVIAL(info) << "Trace: " << var_map["trace"].as<std::string>();
+    }
+    if (var_map.count("calibration")) {
+	BOOST_LOG_TRIVIAL(info) << "Calibration: " << var_map["calibration"].as<std::string>();
+    }
+    if (var_map.count("cache-dir")) {
+	BOOST_LOG_TRIVIAL(info) << "Cache dir: " << var_map["cache-dir"].as<std::string>();
+    }
+    if (incremental) {
+	BOOST_LOG_TRIVIAL(info) << "Delta: " << var_map["delta"].as<std::string>();
+	BOOST_LOG_TRIVIAL(info) << "Previous result: " 
+	    << var_map["previous-result"].as<std::string>();
+    }
+
+    // phase counters cover the main thread, algo_routine also reports on
+    // each of its threads. Phases are also spans of the trace
+    perf_counters phase_counters;
+    uint64_t phase_start = 0;
+    auto start_phase = [&]() {
+	phase_start = trace_start();
+	if (profile) {
+	    phase_counters = start_counters();
+	}
+    };
+    auto end_phase = [&](const char *phase) {
+	trace_complete(phase, phase_start);
+	if (profile) {
+	    BOOST_LOG_TRIVIAL(info) << "Profile - " << phase << " - " 
+		<< format_counters(stop_counters(phase_counters));
+	}
+    };
+
+    if (stream) {
+	BOOST_LOG_TRIVIAL(info) << "Running stream_routine";
+	start_phase();
+	auto start = std::chrono::high_resolution_clock::now();
+	std::unique_ptr<std::ostream> file_out = open_output(var_map["output"].as<std::string>());
+	if (!*file_out) {
+	    BOOST_LOG_TRIVIAL(error) << "Error: could not open output";
+	    exit(EXIT_FAILURE);
+	}
+	stream_stats stats;
+	adjacency_list stream_result = stream_routine(var_map["input"].as<std::string>(),
+		*file_out, reservoir_size, stats);
+	const bool write_failed = !*file_out;
+	// compressed output is only complete once the stream is closed
+	file_out.reset();
+	std::chrono::duration<double> stream_elapsed =
+	    std::chrono::high_resolution_clock::now() - start;
+	end_phase("stream");
+
+	if (write_failed) {
+	    BOOST_LOG_TRIVIAL(error) << "Error: could not write output";
+	    exit(EXIT_FAILURE);
+	}
+	if (!boyer_myrvold_test(stream_result)) {
+	    BOOST_LOG_TRIVIAL(error) << "Error: the result graph is not planar";
+	    exit(EXIT_FAILURE);
+	}
+
+	BOOST_LOG_TRIVIAL(info) << "Execution time: " << stream_elapsed.count() << "s";
+	BOOST_LOG_TRIVIAL(info) << "Edges read: " << stats.edges_read << " nodes: "
+	    << stream_result.size();
+	BOOST_LOG_TRIVIAL(info) << "Edges written: " << stats.accepted << " ("
+	    << stats.reservoir_accepted << " from the reservoir)";
+	BOOST_LOG_TRIVIAL(info) << "Percent of edges read retained: "
+	    << (float) stats.accepted / (float) stats.edges_read * 100;
+	if (var_map.count("trace") && !write_trace(var_map["trace"].as<std::string>())) {
+	    BOOST_LOG_TRIVIAL(warning) << "Could not write trace";
+	}
+	return 0;
+    }
+
+    // picks num_threads and the partition count once the input is loaded,
+    // after the cache lookup so that a hit doesn't pay for calibrating
+    size_t auto_partitions = 0;
+    auto choose_auto = [&](const adjacency_list &graph) {
+	trace_scope auto_span("auto");
+	const graph_stats stats = sample_graph_stats(graph);
+	BOOST_LOG_TRIVIAL(info) << "Auto - nodes: " << stats.num_nodes << " edges: "
+	    << stats.num_edges << " max degree: " << stats.max_degree << " mean degree: "
+	    << stats.mean_degree << " degree cv: " << stats.degree_cv;
+
+	double edge_cost = 0;
+	const std::string calibration_path = var_map.count("calibration") ?
+	    var_map["calibration"].as<std::string>() : "";
+	if (!calibration_path.empty() && load_calibration(calibration_path, edge_cost)) {
+	    BOOST_LOG_TRIVIAL(info) << "Auto - edge cost from " << calibration_path << ": "
+		<< edge_cost << "s";
+	} else {
+	    edge_cost = calibrate_edge_cost(graph);
+	    BOOST_LOG_TRIVIAL(info) << "Auto - measured edge cost: " << edge_cost << "s";
+	    if (!calibration_path.empty() && !store_calibration(calibration_path, edge_cost)) {
+		BOOST_LOG_TRIVIAL(warning) << "Could not store calibration";
+	    }
+	}
+
+	const auto_choice choice = choose_threads(stats, edge_cost, omp_get_num_procs());
+	num_threads = choice.threads;
+	auto_partitions = choice.partitions;
+	BOOST_LOG_TRIVIAL(info) << "Auto - predicted single thread time: "
+	    << choice.serial_seconds << "s, chose " << choice.threads << " threads and "
+	    << choice.partitions << " partitions, limited by " << choice.limit;
+    };
 
     BOOST_LOG_TRIVIAL(info) << "Loading input";
+    start_phase();
     
     adjacency_list input_graph;
     std::unordered_map<node, std::string> node_labels;
-    load_result lr;
+    std::unordered_map<std::string, node> node_ids;
+    std::string cache_entry_key;
 
     if (large_graph ) {
 	input_graph = load_adj_list(var_map["input"].as<std::string>(),
 				    num_input_nodes);
+	// dedup input graph, load_graph already does this for labeled input
+	dedup(input_graph);
+	if (auto_tune) {
+	    choose_auto(input_graph);
+	}
     } else {
-	load_result lr = load_edge_list(var_map["input"].as<std::string>());
-	input_graph = to_adj_list(std::get<0>(lr));
-	node_labels = std::get<2>(lr);
+	uint64_t input_hash;
+	graph_load_result lr = load_graph(var_map["input"].as<std::string>(), &input_hash);
+
+	if (var_map.count("cache-dir") && !incremental && 
+		var_map["output"].as<std::string>() != "-") {
+	    // everything that can change the output goes into the key
+	    std::stringstream options;
+	    if (auto_tune) {
+		// the measured edge cost varies from run to run, so auto is
+		// keyed on what doesn't: the input, which the hash covers, the
+		// cpus and a stored calibration
+		options << "threads=auto;procs=" << omp_get_num_procs();
+		double edge_cost;
+		if (var_map.count("calibration") &&
+			load_calibration(var_map["calibration"].as<std::string>(), edge_cost)) {
+		    options << ";edge_cost=" << edge_cost;
+		}
+	    } else {
+		options << "threads=" << num_threads;
+	    }
+	    options << ";compressed=" << compressed
+		<< ";blocks=" << blocks << ";peel=" << peel << ";pin_threads=" << pin_threads
+		<< ";portfolio=" << portfolio_runs
+		// cached entries are copied to the output as they are, so they
+		// are only reused for outputs in the same format
+		<< ";output_compression="
+		<< compression_from_extension(var_map["output"].as<std::string>())
+		<< ";graphlets=houses,houses_alt,diamonds,diamonds_alt,triangles"
+		<< ";commit=" << GIT_COMMIT_HASH;
+	    cache_entry_key = cache_key(input_hash, options.str());
+
+	    if (cache_lookup(var_map["cache-dir"].as<std::string>(), cache_entry_key,
+			var_map["output"].as<std::string>())) {
+		BOOST_LOG_TRIVIAL(info) << "Cache hit for key " << cache_entry_key
+		    << ", wrote cached result to output";
+		return 0;
+	    }
+	    BOOST_LOG_TRIVIAL(info) << "Cache miss for key " << cache_entry_key;
+	}
+
+	if (auto_tune) {
+	    choose_auto(std::get<0>(lr));
+	}
+
+	input_graph = std::move(std::get<0>(lr));
+	node_labels = std::move(std::get<2>(lr));
+	if (incremental) {
+	    node_ids = std::move(std::get<1>(lr));
+	}
     
     
 	BOOST_LOG_TRIVIAL(info) << "Checking to see if graph is already planar";
 
-	if (boyer_myrvold_test(input_graph)) {
+	if (!incremental && boyer_myrvold_test(input_graph)) {
 	    BOOST_LOG_TRIVIAL(info) << "The provided graph is already planar";
 	    exit(EXIT_SUCCESS);
 	}
     }
-    // dedup input graph
-    dedup(input_graph);
 
-    BOOST_LOG_TRIVIAL(info) << "Running algo_routine";
-    auto start = std::chrono::high_resolution_clock::now();
-    adjacency_list result_graph = algo_routine(input_graph, num_threads);
-    auto finish = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = finish - start;
+    size_t input_n_nodes = input_graph.size();
+    size_t input_n_edges = num_edges(input_graph);
+    end_phase("load");
+
+    adjacency_list result_graph;
+    std::chrono::duration<double> elapsed;
+
+    // started before the algorithm so that output overlaps computation
+    std::unique_ptr<edge_writer> writer;
+    if (async_write) {
+	writer = std::make_unique<edge_writer>(var_map["output"].as<std::string>(), node_labels);
+    }
+    // streamed edges a repair takes back are undone by writing the whole
+    // result over the file. Stdout and FIFOs can't be written again, so
+    // there nothing is streamed before the result is validated
+    const bool hold_output = async_write &&
+	!output_rewritable(var_map["output"].as<std::string>());
+
+    algo_options options;
+    // with peel, the core result has contracted edges that aren't in the
+    // input, so output only goes to the writer once it is restored
+    options.writer = peel || hold_output ? nullptr : writer.get();
+    // bridges are only written once the result is known to be planar, as
+    // repairing it may take some back
+    edge_list held_bridges;
+    options.bridges = &held_bridges;
+    // set where the whole result is written at the end instead
+    bool push_result = hold_output;
+    options.time_limit = time_limit;
+    size_t nodes_covered = 0;
+    options.nodes_covered = &nodes_covered;
+    options.pin_threads = pin_threads;
+    options.num_partitions = auto_partitions;
+    std::vector<counter_values> thread_counters;
+    std::vector<int> thread_numa_nodes;
+    std::vector<size_t> support_histogram;
+    if (profile) {
+	options.thread_counters = &thread_counters;
+	options.thread_numa_nodes = &thread_numa_nodes;
+	options.support_histogram = &support_histogram;
+    }
+    start_phase();
+
+    peeled_graph peeled;
+    std::chrono::duration<double> peel_elapsed(0);
+    if (peel) {
+	BOOST_LOG_TRIVIAL(info) << "Peeling trees and chains";
+	trace_scope peel_span("peel");
+	auto start = std::chrono::high_resolution_clock::now();
+	peeled = peel_graph(input_graph, num_threads);
+	input_graph = std::move(peeled.core);
+	peel_elapsed = std::chrono::high_resolution_clock::now() - start;
+	BOOST_LOG_TRIVIAL(info) << "Core graph - nodes: " << input_graph.size() 
+	    << " edges: " << num_edges(input_graph) << " chains: " << peeled.chains.size();
+    }
+
+    if (incremental) {
+	result_graph = to_adj_list(load_labeled_edges(var_map["previous-result"].as<std::string>(),
+		    node_ids, node_labels));
+	edge_list inserted;
+	edge_list deleted;
+	load_delta(var_map["delta"].as<std::string>(), node_ids, node_labels, inserted, deleted);
+	BOOST_LOG_TRIVIAL(info) << "Delta - inserted: " << inserted.size() 
+	    << " deleted: " << deleted.size();
+
+	BOOST_LOG_TRIVIAL(info) << "Running update_routine";
+	auto start = std::chrono::high_resolution_clock::now();
+	update_routine(input_graph, result_graph, inserted, deleted);
+	auto finish = std::chrono::high_resolution_clock::now();
+	elapsed = finish - start;
+
+	for (auto &[key_node, adjs] : input_graph) {
+	    add_node(result_graph, key_node, adjs.size());
+	}
+	input_n_nodes = input_graph.size();
+	input_n_edges = num_edges(input_graph);
+	push_result = true;
+    } else if (portfolio_runs > 0) {
+	BOOST_LOG_TRIVIAL(info) << "Running portfolio_routine";
+	auto start = std::chrono::high_resolution_clock::now();
+	size_t winner;
+	result_graph = portfolio_routine(input_graph, make_portfolio(portfolio_runs, options),
+		num_threads, &winner);
+	auto finish = std::chrono::high_resolution_clock::now();
+	elapsed = finish - start;
+	BOOST_LOG_TRIVIAL(info) << "Portfolio winner: run " << winner;
+
+	// only the winning result is written
+	push_result = true;
+    } else if (blocks) {
+	BOOST_LOG_TRIVIAL(info) << "Running block_routine";
+	auto start = std::chrono::high_resolution_clock::now();
+	result_graph = block_routine(input_graph, num_threads, options);
+	auto finish = std::chrono::high_resolution_clock::now();
+	elapsed = finish - start;
+    } else if (compressed) {
+	// the uncompressed input is released before running so that only the
+	// compressed copy is held in memory
+	compressed_graph compressed_input = compress(input_graph);
+	adjacency_list().swap(input_graph);
+	BOOST_LOG_TRIVIAL(info) << "Compressed input size: " 
+	    << size_in_bytes(compressed_input) << " bytes";
+
+	BOOST_LOG_TRIVIAL(info) << "Running algo_routine";
+	auto start = std::chrono::high_resolution_clock::now();
+	result_graph = algo_routine(compressed_input, num_threads, options);
+	auto finish = std::chrono::high_resolution_clock::now();
+	elapsed = finish - start;
+    } else {
+	BOOST_LOG_TRIVIAL(info) << "Running algo_routine";
+	auto start = std::chrono::high_resolution_clock::now();
+	result_graph = algo_routine(input_graph, num_threads, options);
+	auto finish = std::chrono::high_resolution_clock::now();
+	elapsed = finish - start;
+    }
+
+    if (peel) {
+	auto start = std::chrono::high_resolution_clock::now();
+	restore_peeled(peeled, result_graph);
+	nodes_covered += peeled.peeled_nodes.size();
+	elapsed += std::chrono::high_resolution_clock::now() - start + peel_elapsed;
+	push_result = true;
+    }
     
+    end_phase("algo");
+    // a result cut short by the deadline is still valid, but not worth caching
+    const bool timed_out = past_deadline(time_limit);
+    if (timed_out) {
+	BOOST_LOG_TRIVIAL(warning) << "Time limit reached, returning the partial result";
+	cache_entry_key.clear();
+    }
+    if (time_limit != NO_DEADLINE && !incremental) {
+	BOOST_LOG_TRIVIAL(info) << "Coverage: " << nodes_covered << " of " << input_n_nodes
+	    << " nodes (" << (float) nodes_covered / (float) input_n_nodes * 100 << "%)";
+    }
+    // per socket totals show whether the work was split evenly over nodes
+    std::map<int, counter_values> node_counters;
+    for (size_t idx = 0; idx < thread_counters.size(); idx++) {
+	BOOST_LOG_TRIVIAL(info) << "Profile - algo thread " << idx << " (node "
+	    << thread_numa_nodes.at(idx) << ") - " << format_counters(thread_counters.at(idx));
+	auto search = node_counters.emplace(thread_numa_nodes.at(idx), empty_counter_values());
+	add_counter_values(search.first->second, thread_counters.at(idx));
+    }
+    for (auto &[numa_node, counters] : node_counters) {
+	BOOST_LOG_TRIVIAL(info) << "Profile - algo node " << numa_node << " - " 
+	    << format_counters(counters);
+    }
+    // edges by the number of triangles they are in, within their partition
+    if (!support_histogram.empty()) {
+	BOOST_LOG_TRIVIAL(info) << "Profile - triangle support - "
+	    << format_support_histogram(support_histogram);
+    }
+
+    start_phase();
     dedup(result_graph);
-    
-    if (!large_graph) {
+
+    // a non-planar result is repaired rather than thrown away
+    if (!large_graph && !boyer_myrvold_test(result_graph)) {
+	BOOST_LOG_TRIVIAL(warning) << "The result graph is not planar, repairing";
+	trace_scope repair_span("repair");
+	const repair_stats repair = repair_planarity(result_graph, held_bridges);
+	BOOST_LOG_TRIVIAL(info) << "Repair - non-planar blocks: " << repair.nonplanar_blocks
+	    << " removed added edges: " << repair.removed_added
+	    << " removed graphlet edges: " << repair.removed_other;
+
+	std::unordered_set<std::pair<node, node>, edge_hash> held;
+	for (std::pair<node, node> edge : held_bridges) {
+	    held.insert(std::minmax(edge.first, edge.second));
+	}
+	std::unordered_set<std::pair<node, node>, edge_hash> removed;
+	bool removed_written = false;
+	for (std::pair<node, node> edge : repair.removed) {
+	    removed.insert(std::minmax(edge.first, edge.second));
+	    removed_written |= held.count(std::minmax(edge.first, edge.second)) == 0;
+	}
+	held_bridges.erase(std::remove_if(held_bridges.begin(), held_bridges.end(),
+		    [&](std::pair<node, node> edge) {
+	    return removed.count(std::minmax(edge.first, edge.second)) > 0;
+	}), held_bridges.end());
+
+	// edges the writer already has can't be taken back, so the streamed
+	// output is replaced by the whole repaired result
+	if (writer && !push_result && removed_written) {
+	    BOOST_LOG_TRIVIAL(warning) << "Repair removed edges that were already written, "
+		<< "rewriting the output";
+	    writer->finish();
+	    writer.reset();
+	}
 	if (!boyer_myrvold_test(result_graph)) {
 	    BOOST_LOG_TRIVIAL(error) << "Error: the result graph is not planar";
 	    exit(EXIT_FAILURE);
 	}
     }
-    size_t input_n_edges = num_edges(input_graph);
+
+    if (writer) {
+	writer->push(push_result ? to_edge_list(result_graph) : held_bridges);
+    }
+    if (writer && !writer->finish()) {
+	BOOST_LOG_TRIVIAL(error) << "Error: could not write output";
+	exit(EXIT_FAILURE);
+    }
     size_t result_n_edges = num_edges(result_graph);
+    end_phase("validation");
 
     BOOST_LOG_TRIVIAL(info) << "Execution time: " << elapsed.count() << "s";
-    BOOST_LOG_TRIVIAL(info) << "Initial graph - " << "nodes: " << input_graph.size()
+    BOOST_LOG_TRIVIAL(info) << "Initial graph - " << "nodes: " << input_n_nodes
         << " edges: " << input_n_edges;
     BOOST_LOG_TRIVIAL(info) << "Result graph - " << "nodes: " << result_graph.size()
         << " edges: " << result_n_edges;
     BOOST_LOG_TRIVIAL(info) << "Percent edges retained: "
         << (float) result_n_edges / (float) input_n_edges * 100;
     
-    if (!large_graph) {
+    if (writer) {
+	BOOST_LOG_TRIVIAL(info) << "Edges written: " << writer->edges_written();
+    } else if (!large_graph) {
+	start_phase();
 	write_graph(result_graph, node_labels, var_map["output"].as<std::string>());
+	end_phase("write");
+    }
+
+    if (var_map.count("trace")) {
+	if (write_trace(var_map["trace"].as<std::string>())) {
+	    BOOST_LOG_TRIVIAL(info) << "Wrote trace to " << var_map["trace"].as<std::string>();
+	} else {
+	    BOOST_LOG_TRIVIAL(warning) << "Could not write trace";
+	}
+    }
+
+    if (!cache_entry_key.empty()) {
+	if (cache_store(var_map["cache-dir"].as<std::string>(), cache_entry_key,
+		    var_map["output"].as<std::string>())) {
+	    BOOST_LOG_TRIVIAL(info) << "Stored result in cache";
+	} else {
+	    BOOST_LOG_TRIVIAL(warning) << "Could not store result in cache";
+	}
     }
     
     return 0;
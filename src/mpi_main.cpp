@@ -0,0 +1,225 @@
+#include "algo.h"
+
+#include <chrono>
+#include <climits>
+#include <mpi.h>
+#include <stdlib.h>
+#include <version.h>
+
+#include "boost/program_options.hpp"
+#include "boost/log/trivial.hpp"
+
+// Distributed version of planarityfilter, which spreads the propagation over
+// the cores of several machines. Every rank loads the input and computes the
+// same partitioning, with threads partitions per rank. Each rank runs the
+// propagation on its own partitions with OpenMP and bridges the components
+// among them, then the edges are gathered on rank 0, which bridges the
+// remaining components, validates and writes the result.
+//
+// NOTE the input isn't sharded, so every rank needs as much memory as a
+// single process run, and rank 0 more, as it also holds the gathered result
+//
+// Run with e.g. mpirun -np 4 planarityfilter_mpi -i in.txt -o out.txt -t 8
+
+// Most edges a rank sends in one MPI_Gatherv
+#define MPI_GATHER_CHUNK_EDGES (1 << 24)
+
+// Gathers every rank's edges on rank 0, and nothing on the other ranks.
+// MPI_Gatherv takes int counts and displacements, so the counts are
+// exchanged as 64-bit ints and the edges sent in rounds of at most chunk
+// edges per rank, where chunk times the number of ranks fits in an int
+edge_list gather_edges(const edge_list &local_edges, const int rank, const int num_ranks) {
+    static_assert(sizeof(std::pair<node, node>) == 2 * sizeof(uint64_t),
+	    "edges must be two 64-bit ints");
+    // edges are sent as pairs of 64-bit ints, so counts are in edges
+    MPI_Datatype edge_type;
+    MPI_Type_contiguous(2, MPI_UINT64_T, &edge_type);
+    MPI_Type_commit(&edge_type);
+
+    const uint64_t local_count = local_edges.size();
+    std::vector<uint64_t> counts(num_ranks);
+    MPI_Gather(&local_count, 1, MPI_UINT64_T, counts.data(), 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    uint64_t max_count;
+    MPI_Allreduce(&local_count, &max_count, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+
+    edge_list all_edges;
+    if (rank == 0) {
+	uint64_t total = 0;
+	for (uint64_t count : counts) {
+	    if (count > all_edges.max_size() - total) {
+		BOOST_LOG_TRIVIAL(error) << "Error: too many edges to gather on rank 0";
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	    }
+	    total += count;
+	}
+	all_edges.resize(total);
+    }
+
+    const uint64_t chunk = std::min((uint64_t) MPI_GATHER_CHUNK_EDGES,
+	    (uint64_t) (INT_MAX / num_ranks));
+    std::vector<int> round_counts(num_ranks, 0);
+    std::vector<int> displacements(num_ranks, 0);
+    size_t received = 0;
+
+    for (uint64_t sent = 0; sent < max_count; sent += chunk) {
+	const uint64_t local_sent = std::min(sent, local_count);
+	const int send_count = (int) std::min(chunk, local_count - local_sent);
+
+	int round_total = 0;
+	if (rank == 0) {
+	    for (int idx = 0; idx < num_ranks; idx++) {
+		displacements.at(idx) = round_total;
+		round_counts.at(idx) = (int) std::min(chunk,
+			counts.at(idx) - std::min(sent, counts.at(idx)));
+		round_total += round_counts.at(idx);
+	    }
+	}
+
+	MPI_Gatherv(local_edges.data() + local_sent, send_count, edge_type,
+		all_edges.data() + received, round_counts.data(), displacements.data(),
+		edge_type, 0, MPI_COMM_WORLD);
+	received += round_total;
+    }
+    MPI_Type_free(&edge_type);
+
+    return all_edges;
+}
+
+int main(int argc, char *argv[]) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank;
+    int num_ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+    // the propagation runs OpenMP threads, with MPI only called from the
+    // main thread
+    if (provided < MPI_THREAD_FUNNELED) {
+	if (rank == 0) {
+	    std::cerr << "ERROR: the MPI library doesn't support MPI_THREAD_FUNNELED\n";
+	}
+	MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    int num_threads = 1;
+
+    namespace po = boost::program_options;
+
+    po::options_description desc("Arguments");
+    desc.add_options()("help,h", "display help message")
+        ("input,i", po::value<std::string>()->required(), "input file path")
+        ("output,o", po::value<std::string>()->required(), "output file path")
+	("threads,t", po::value<int>(&num_threads), "number of threads to use on each rank");
+
+    po::variables_map var_map;
+
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), var_map);
+        if (var_map.count("help")) {
+	    if (rank == 0) {
+		std::cout << desc << "\n";
+	    }
+	    MPI_Finalize();
+            return 0;
+        }
+        po::notify(var_map);
+    } catch (po::error &e) {
+	if (rank == 0) {
+	    std::cerr << "ERROR: " << e.what() << "\n";
+	    std::cerr << desc << "\n";
+	}
+	MPI_Finalize();
+        return 1;
+    }
+
+    if (rank == 0) {
+	BOOST_LOG_TRIVIAL(info) << "#######################################";
+	BOOST_LOG_TRIVIAL(info) << "New MPI run, options listed below";
+	BOOST_LOG_TRIVIAL(info) << "git branch: " << GIT_BRANCH;
+	BOOST_LOG_TRIVIAL(info) << "abbrev. commit hash: " << GIT_COMMIT_HASH;
+	BOOST_LOG_TRIVIAL(info) << "Input: " << var_map["input"].as<std::string>();
+	BOOST_LOG_TRIVIAL(info) << "Output: " << var_map["output"].as<std::string>();
+	BOOST_LOG_TRIVIAL(info) << "Num. ranks: " << num_ranks;
+	BOOST_LOG_TRIVIAL(info) << "Num. threads per rank: " << num_threads;
+	BOOST_LOG_TRIVIAL(info) << "Loading input";
+    }
+
+    graph_load_result lr = load_graph(var_map["input"].as<std::string>());
+    const adjacency_list &input_graph = std::get<0>(lr);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // partitioning is deterministic, so every rank gets the same partitions
+    // without any communication. Partitions owned by other ranks are dropped
+    std::vector<partition_view<adjacency_list>> partitions = partition_nodes(input_graph,
+	    (size_t) num_ranks * num_threads);
+    std::vector<size_t> indices;
+    adjacency_list local_out;
+
+    for (size_t idx = 0; idx < partitions.size(); idx++) {
+	if (idx % num_ranks == (size_t) rank) {
+	    indices.push_back(idx);
+	    for (node key_node : partitions.at(idx).nodes) {
+		add_node(local_out, key_node, get_degree(partitions.at(idx), key_node));
+	    }
+	} else {
+	    std::vector<node>().swap(partitions.at(idx).nodes);
+	}
+    }
+
+    propagate_partitions(partitions, indices, local_out, num_threads);
+    std::vector<partition_view<adjacency_list>>().swap(partitions);
+
+    // bridging among this rank's partitions happens locally, only the
+    // components that span ranks are left for rank 0
+    bridge_components(local_out, input_graph);
+
+    const edge_list local_edges = to_edge_list(local_out);
+    adjacency_list().swap(local_out);
+
+    const edge_list all_edges = gather_edges(local_edges, rank, num_ranks);
+
+    int exit_code = EXIT_SUCCESS;
+
+    if (rank == 0) {
+	adjacency_list result_graph;
+	result_graph.reserve(input_graph.size());
+	for (auto &[key_node, adjs] : input_graph) {
+	    add_node(result_graph, key_node, adjs.size());
+	}
+	for (std::pair<node, node> edge : all_edges) {
+	    add_edge(result_graph, edge.first, edge.second);
+	}
+
+	bridge_components(result_graph, input_graph);
+	auto finish = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = finish - start;
+
+	dedup(result_graph);
+
+	if (!boyer_myrvold_test(result_graph)) {
+	    BOOST_LOG_TRIVIAL(error) << "Error: the result graph is not planar";
+	    exit_code = EXIT_FAILURE;
+	} else {
+	    size_t input_n_edges = num_edges(input_graph);
+	    size_t result_n_edges = num_edges(result_graph);
+
+	    BOOST_LOG_TRIVIAL(info) << "Execution time: " << elapsed.count() << "s";
+	    BOOST_LOG_TRIVIAL(info) << "Initial graph - " << "nodes: " << input_graph.size()
+		<< " edges: " << input_n_edges;
+	    BOOST_LOG_TRIVIAL(info) << "Result graph - " << "nodes: " << result_graph.size()
+		<< " edges: " << result_n_edges;
+	    BOOST_LOG_TRIVIAL(info) << "Percent edges retained: "
+		<< (float) result_n_edges / (float) input_n_edges * 100;
+
+	    write_graph(result_graph, std::get<2>(lr), var_map["output"].as<std::string>());
+	}
+    }
+
+    MPI_Bcast(&exit_code, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Finalize();
+
+    return exit_code;
+}
@@ -0,0 +1,164 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#endif
+
+// NUMA topology from sysfs and thread pinning. Where the topology can't be
+// read, every cpu is on node 0, and where pinning isn't possible it is a
+// no-op, so single socket machines and other platforms just work
+
+// Parses a sysfs cpu list such as "0-3,8-11"
+std::vector<int> parse_cpu_list(const std::string &cpu_list) {
+    std::vector<int> cpus;
+    size_t start = 0;
+
+    while (start < cpu_list.size()) {
+	size_t end = cpu_list.find(',', start);
+	if (end == std::string::npos) {
+	    end = cpu_list.size();
+	}
+	const std::string range = cpu_list.substr(start, end - start);
+	const size_t dash = range.find('-');
+
+	try {
+	    if (dash == std::string::npos) {
+		cpus.push_back(std::stoi(range));
+	    } else {
+		const int first = std::stoi(range.substr(0, dash));
+		const int last = std::stoi(range.substr(dash + 1));
+		for (int cpu = first; cpu <= last; cpu++) {
+		    cpus.push_back(cpu);
+		}
+	    }
+	} catch (std::exception &) {
+	    // blank lines and trailing newlines
+	}
+
+	start = end + 1;
+    }
+
+    return cpus;
+}
+
+// Gets the NUMA node of each cpu, indexed by cpu
+std::vector<int> get_cpu_nodes() {
+    std::vector<int> cpu_nodes;
+
+#ifdef __linux__
+    DIR *node_dir = opendir("/sys/devices/system/node");
+    if (node_dir != nullptr) {
+	while (struct dirent *entry = readdir(node_dir)) {
+	    const std::string name = entry->d_name;
+	    if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+		    name.find_first_not_of("0123456789", 4) != std::string::npos) {
+		continue;
+	    }
+
+	    std::ifstream file_in("/sys/devices/system/node/" + name + "/cpulist");
+	    std::string cpu_list;
+	    getline(file_in, cpu_list);
+
+	    for (int cpu : parse_cpu_list(cpu_list)) {
+		if (cpu >= (int) cpu_nodes.size()) {
+		    cpu_nodes.resize(cpu + 1, 0);
+		}
+		cpu_nodes.at(cpu) = std::stoi(name.substr(4));
+	    }
+	}
+	closedir(node_dir);
+    }
+#endif
+
+    return cpu_nodes;
+}
+
+// Gets the NUMA node that the calling thread is running on
+int current_numa_node() {
+#ifdef __linux__
+    static const std::vector<int> cpu_nodes = get_cpu_nodes();
+    const int cpu = sched_getcpu();
+    if (cpu >= 0 && cpu < (int) cpu_nodes.size()) {
+	return cpu_nodes.at(cpu);
+    }
+#endif
+    return 0;
+}
+
+// Gets the cpus this process may run on, interleaved across nodes so that
+// consecutive threads are spread over all of the sockets
+std::vector<int> get_allowed_cpus() {
+    std::vector<int> cpus;
+
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+	return cpus;
+    }
+
+    const std::vector<int> cpu_nodes = get_cpu_nodes();
+    std::vector<std::vector<int>> node_cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+	if (CPU_ISSET(cpu, &allowed)) {
+	    const size_t numa_node = cpu < (int) cpu_nodes.size() ? cpu_nodes.at(cpu) : 0;
+	    if (numa_node >= node_cpus.size()) {
+		node_cpus.resize(numa_node + 1);
+	    }
+	    node_cpus.at(numa_node).push_back(cpu);
+	}
+    }
+
+    for (size_t idx = 0; cpus.size() < (size_t) CPU_COUNT(&allowed); idx++) {
+	for (const std::vector<int> &this_node_cpus : node_cpus) {
+	    if (idx < this_node_cpus.size()) {
+		cpus.push_back(this_node_cpus.at(idx));
+	    }
+	}
+    }
+#endif
+
+    return cpus;
+}
+
+// Pins the calling thread to a cpu while in scope, then restores the cpus
+// it was allowed before. Threads started afterwards, from this thread or
+// the OpenMP pool, inherit its mask, so pinning is never left behind
+struct thread_pin {
+    bool pinned = false;
+#ifdef __linux__
+    cpu_set_t saved;
+#endif
+
+    explicit thread_pin(const int cpu) {
+#ifdef __linux__
+	CPU_ZERO(&saved);
+	if (sched_getaffinity(0, sizeof(saved), &saved) != 0) {
+	    return;
+	}
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	CPU_SET(cpu, &cpu_set);
+	pinned = sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0;
+#endif
+    }
+
+    ~thread_pin() {
+#ifdef __linux__
+	if (pinned) {
+	    sched_setaffinity(0, sizeof(saved), &saved);
+	}
+#endif
+    }
+
+    thread_pin(const thread_pin &) = delete;
+    thread_pin &operator=(const thread_pin &) = delete;
+};
+
+#endif
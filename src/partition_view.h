@@ -0,0 +1,185 @@
+#ifndef PARTITION_VIEW_H
+#define PARTITION_VIEW_H
+
+#include "compressed_graph.h"
+
+#include <iterator>
+#include <memory>
+
+// A partition of a graph, read through the graph itself instead of a copy.
+// Every node gets a partition id in one array shared by all the partitions
+// of a graph, and the adjacents of a node in a view are its adjacents in the
+// graph masked to those with the same id. Partitioning then takes O(n)
+// bytes, for the ids, the degrees within each partition and the member
+// lists, and every thread reads the one shared graph
+
+// Partition id of nodes that aren't in any partition
+#define NO_PARTITION UINT32_MAX
+// Ids and degrees go in a hash map instead of arrays when the largest node
+// id is more than this many times the number of nodes, as with --large
+// inputs whose numeric ids are sparse
+#define PARTITION_MAP_MAX_SPREAD 4
+
+// Partition ids and the degree of each node within its partition, either
+// in arrays indexed by node id or, for sparse ids, in a hash map keyed on it
+struct partition_map {
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> degrees;
+    bool is_sparse = false;
+    // id then degree of each node, when is_sparse
+    std::unordered_map<node, std::pair<uint32_t, uint32_t>> sparse;
+};
+
+// Sets up an empty map for a graph of num_nodes nodes up to max_node
+void init_partition_map(partition_map &map, const size_t num_nodes, const node max_node) {
+    map.is_sparse = num_nodes > 0 && max_node / PARTITION_MAP_MAX_SPREAD >= num_nodes;
+    if (map.is_sparse) {
+	map.sparse.reserve(num_nodes);
+    } else {
+	map.ids.assign(num_nodes > 0 ? max_node + 1 : 0, NO_PARTITION);
+	map.degrees.assign(map.ids.size(), 0);
+    }
+}
+
+// Gets the partition id of a node, NO_PARTITION if it has none
+uint32_t get_partition(const partition_map &map, const node key_node) {
+    if (map.is_sparse) {
+	auto search = map.sparse.find(key_node);
+	return search == map.sparse.end() ? NO_PARTITION : search->second.first;
+    }
+    return map.ids[key_node];
+}
+
+void set_partition(partition_map &map, const node key_node, const uint32_t id) {
+    if (map.is_sparse) {
+	map.sparse[key_node].first = id;
+    } else {
+	map.ids.at(key_node) = id;
+    }
+}
+
+// Gets the degree of a node within its partition
+uint32_t get_partition_degree(const partition_map &map, const node key_node) {
+    return map.is_sparse ? map.sparse.at(key_node).second : map.degrees.at(key_node);
+}
+
+void set_partition_degree(partition_map &map, const node key_node, const uint32_t degree) {
+    if (map.is_sparse) {
+	map.sparse.at(key_node).second = degree;
+    } else {
+	map.degrees.at(key_node) = degree;
+    }
+}
+
+template <typename G>
+struct partition_view {
+    const G *graph = nullptr;
+    std::shared_ptr<const partition_map> map;
+    uint32_t id = 0;
+    // the nodes in the partition, in the order they were added
+    std::vector<node> nodes;
+};
+
+// The type get_adjs gives for a graph, a reference for adjacency lists
+template <typename G>
+using source_adjs = decltype(get_adjs(std::declval<const G &>(), node()));
+
+// Iterates over the adjacents of a node that are in the partition id
+template <typename I>
+struct masked_iterator {
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = node;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const node *;
+    using reference = node;
+
+    I iter;
+    I end;
+    const partition_map *map;
+    uint32_t id;
+
+    masked_iterator(I iter, I end, const partition_map *map, const uint32_t id) :
+	iter(iter), end(end), map(map), id(id) {
+	skip();
+    }
+
+    void skip() {
+	while (iter != end && get_partition(*map, *iter) != id) {
+	    ++iter;
+	}
+    }
+
+    node operator*() const { return *iter; }
+
+    masked_iterator &operator++() {
+	++iter;
+	skip();
+	return *this;
+    }
+
+    masked_iterator operator++(int) {
+	masked_iterator prev = *this;
+	++(*this);
+	return prev;
+    }
+
+    bool operator==(const masked_iterator &other) const { return iter == other.iter; }
+    bool operator!=(const masked_iterator &other) const { return iter != other.iter; }
+};
+
+// The adjacents of a node within a partition. The size is the degree
+// within the partition, counted when the partitions were made
+template <typename G>
+struct masked_adjs {
+    source_adjs<G> adjs;
+    const partition_map *map;
+    uint32_t id;
+    size_t degree;
+
+    auto begin() const {
+	return masked_iterator<decltype(adjs.begin())>(adjs.begin(), adjs.end(), map, id);
+    }
+    auto end() const {
+	return masked_iterator<decltype(adjs.begin())>(adjs.end(), adjs.end(), map, id);
+    }
+    size_t size() const { return degree; }
+    bool empty() const { return degree == 0; }
+};
+
+template <typename G>
+masked_adjs<G> get_adjs(const partition_view<G> &view, const node key_node) {
+    return masked_adjs<G> {get_adjs(*view.graph, key_node), view.map.get(), view.id,
+	get_partition_degree(*view.map, key_node)};
+}
+
+template <typename G>
+size_t get_degree(const partition_view<G> &view, const node key_node) {
+    return get_partition_degree(*view.map, key_node);
+}
+
+template <typename G>
+size_t num_nodes(const partition_view<G> &view) {
+    return view.nodes.size();
+}
+
+template <typename G, typename F>
+void for_each_node(const partition_view<G> &view, F func) {
+    for (node key_node : view.nodes) {
+	func(key_node);
+    }
+}
+
+// Copies a partition into a graph of its own, in the representation of the
+// source graph
+template <typename G>
+G materialize(const partition_view<G> &view) {
+    adjacency_list adj_list;
+    adj_list.reserve(view.nodes.size());
+    for (node key_node : view.nodes) {
+	const masked_adjs<G> adjs = get_adjs(view, key_node);
+	adj_list.insert({key_node, std::vector<node>(adjs.begin(), adjs.end())});
+    }
+    return build_graph<G>(std::move(adj_list));
+}
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef PEEL_H
+#define PEEL_H
+
+#include "algo.h"
+
+#include <atomic>
+
+// Tree and chain peeling. Pendant trees and paths of degree 2 nodes can
+// never make a graph non-planar, so they are taken out before the algorithm
+// runs and put back afterwards:
+//
+// - pendant trees hang off the rest of the graph at a single node, so all
+//   of their edges can be added to any planar result
+// - a chain between two branching nodes u and v is contracted to an edge
+//   u-v. If the result keeps u-v, every chain between u and v can be drawn
+//   alongside it. If not, each chain minus its last edge is just a path
+//   hanging off u
+// - chains that come back to where they started are cycles through a single
+//   node and can always be added
+
+// The reduced graph the algorithm runs on, and what is needed to restore
+// the peeled structure afterwards
+struct peeled_graph {
+    adjacency_list core;
+    // edges of the pendant trees
+    edge_list tree_edges;
+    // paths through degree 2 nodes, from one endpoint to the other. The
+    // endpoints are the same node for cycles
+    std::vector<std::vector<node>> chains;
+    // core edges that only stand in for chains, smaller node first
+    std::unordered_set<std::pair<node, node>, edge_hash> contracted;
+    // nodes taken out of the core
+    std::vector<node> peeled_nodes;
+};
+
+// Peels the pendant trees and contracts the chains of a deduped graph.
+// Trees are stripped in parallel rounds, each removing the current degree 1
+// nodes, until only the 2-core is left
+peeled_graph peel_graph(const adjacency_list &adj_list, const int threads) {
+    peeled_graph peeled;
+
+    std::vector<node> nodes;
+    std::unordered_map<node, size_t> index;
+    nodes.reserve(adj_list.size());
+    index.reserve(adj_list.size());
+    for (auto &[key_node, adjs] : adj_list) {
+	index.insert({key_node, nodes.size()});
+	nodes.push_back(key_node);
+    }
+
+    std::vector<std::atomic<size_t>> degree(nodes.size());
+    std::vector<std::atomic<bool>> removed(nodes.size());
+    std::vector<size_t> frontier;
+
+    for (size_t idx = 0; idx < nodes.size(); idx++) {
+	degree[idx] = get_degree(adj_list, nodes[idx]);
+	removed[idx] = false;
+	if (degree[idx] <= 1) {
+	    frontier.push_back(idx);
+	}
+    }
+
+    while (!frontier.empty()) {
+	std::vector<size_t> next_frontier;
+
+#pragma omp parallel num_threads(threads)
+	{
+	    std::vector<size_t> local_frontier;
+
+#pragma omp for schedule(dynamic, 256)
+	    for (size_t idx = 0; idx < frontier.size(); idx++) {
+		const size_t this_idx = frontier[idx];
+		if (removed[this_idx].exchange(true)) {
+		    continue;
+		}
+		for (node adj : get_adjs(adj_list, nodes[this_idx])) {
+		    const size_t adj_idx = index.at(adj);
+		    // the degree that drops to 1 queues the node exactly once
+		    if (!removed[adj_idx] && degree[adj_idx].fetch_sub(1) == 2) {
+			local_frontier.push_back(adj_idx);
+		    }
+		}
+	    }
+
+#pragma omp critical(peel_frontier)
+	    next_frontier.insert(next_frontier.end(), local_frontier.begin(),
+		    local_frontier.end());
+	}
+
+	frontier.swap(next_frontier);
+    }
+
+    std::vector<size_t> core_degree(nodes.size(), 0);
+
+#pragma omp parallel for num_threads(threads) schedule(dynamic, 256)
+    for (size_t idx = 0; idx < nodes.size(); idx++) {
+	for (node adj : get_adjs(adj_list, nodes[idx])) {
+	    const size_t adj_idx = index.at(adj);
+	    if (removed[idx] || removed[adj_idx]) {
+		if (nodes[idx] < adj) {
+#pragma omp critical(peel_tree)
+		    peeled.tree_edges.push_back(std::make_pair(nodes[idx], adj));
+		}
+	    } else {
+		core_degree[idx]++;
+	    }
+	}
+    }
+
+    // chains are walked from each of their interior nodes, so each is
+    // found once and then marked
+    std::vector<char> in_chain(nodes.size(), 0);
+
+    for (size_t idx = 0; idx < nodes.size(); idx++) {
+	if (removed[idx] || core_degree[idx] != 2 || in_chain[idx]) {
+	    continue;
+	}
+
+	// walks away from start through degree 2 nodes, adding them to path
+	auto walk = [&](const size_t start, size_t next, std::vector<node> &path) {
+	    size_t previous = start;
+	    while (core_degree[next] == 2 && next != idx) {
+		in_chain[next] = 1;
+		path.push_back(nodes[next]);
+		for (node adj : get_adjs(adj_list, nodes[next])) {
+		    const size_t adj_idx = index.at(adj);
+		    if (!removed[adj_idx] && adj_idx != previous) {
+			previous = next;
+			next = adj_idx;
+			break;
+		    }
+		}
+	    }
+	    path.push_back(nodes[next]);
+	    return next;
+	};
+
+	in_chain[idx] = 1;
+	std::vector<size_t> ends;
+	for (node adj : get_adjs(adj_list, nodes[idx])) {
+	    if (!removed[index.at(adj)]) {
+		ends.push_back(index.at(adj));
+	    }
+	}
+
+	std::vector<node> backward;
+	std::vector<node> chain;
+	const size_t end_0 = walk(idx, ends[0], backward);
+	std::reverse(backward.begin(), backward.end());
+	chain.insert(chain.end(), backward.begin(), backward.end());
+	chain.push_back(nodes[idx]);
+
+	if (end_0 == idx) {
+	    // a cycle of degree 2 nodes with nothing else attached
+	    peeled.chains.push_back(std::move(chain));
+	    continue;
+	}
+
+	walk(idx, ends[1], chain);
+	peeled.chains.push_back(std::move(chain));
+    }
+
+    for (size_t idx = 0; idx < nodes.size(); idx++) {
+	if (removed[idx] || in_chain[idx]) {
+	    peeled.peeled_nodes.push_back(nodes[idx]);
+	} else {
+	    add_node(peeled.core, nodes[idx], core_degree[idx]);
+	}
+    }
+
+    for (auto &[key_node, adjs] : peeled.core) {
+	for (node adj : get_adjs(adj_list, key_node)) {
+	    const size_t adj_idx = index.at(adj);
+	    if (!removed[adj_idx] && !in_chain[adj_idx]) {
+		adjs.push_back(adj);
+	    }
+	}
+    }
+
+    for (const std::vector<node> &chain : peeled.chains) {
+	const node end_0 = std::min(chain.front(), chain.back());
+	const node end_1 = std::max(chain.front(), chain.back());
+	if (end_0 == end_1) {
+	    continue;
+	}
+
+	const std::vector<node> &adjs = get_adjs(adj_list, end_0);
+	if (std::find(adjs.begin(), adjs.end(), end_1) == adjs.end() &&
+		peeled.contracted.insert(std::make_pair(end_0, end_1)).second) {
+	    add_edge(peeled.core, end_0, end_1);
+	}
+    }
+
+    dedup(peeled.core);
+
+    return peeled;
+}
+
+// Puts the peeled trees and chains back into a result computed on the core
+void restore_peeled(const peeled_graph &peeled, adjacency_list &result) {
+    auto has_edge = [&](const node node_0, const node node_1) {
+	auto search = result.find(node_0);
+	return search != result.end() &&
+	    std::find(search->second.begin(), search->second.end(), node_1) !=
+	    search->second.end();
+    };
+
+    std::vector<char> keep_whole(peeled.chains.size());
+    for (size_t idx = 0; idx < peeled.chains.size(); idx++) {
+	const std::vector<node> &chain = peeled.chains.at(idx);
+	keep_whole.at(idx) = chain.front() == chain.back() ||
+	    has_edge(chain.front(), chain.back());
+    }
+
+    for (std::pair<node, node> edge : peeled.contracted) {
+	remove_edge(result, edge.first, edge.second);
+    }
+
+    for (size_t idx = 0; idx < peeled.chains.size(); idx++) {
+	const std::vector<node> &chain = peeled.chains.at(idx);
+	const size_t num_chain_edges = keep_whole.at(idx) ? chain.size() - 1 : chain.size() - 2;
+	for (size_t edge_idx = 0; edge_idx < num_chain_edges; edge_idx++) {
+	    add_edge(result, chain.at(edge_idx), chain.at(edge_idx + 1));
+	}
+    }
+
+    for (std::pair<node, node> edge : peeled.tree_edges) {
+	add_edge(result, edge.first, edge.second);
+    }
+
+    for (node peeled_node : peeled.peeled_nodes) {
+	add_node(result, peeled_node, 0);
+    }
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters for the calling thread, read through Linux
+// perf_event_open. Counters that can't be opened (no PMU access, e.g. in
+// containers or with a strict perf_event_paranoid) read as -1, and
+// everything else keeps working
+
+enum counter_kind { CYCLES, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES, NUM_COUNTERS };
+
+const char *const COUNTER_NAMES[NUM_COUNTERS] = {"cycles", "instructions", "llc_misses",
+    "branch_misses"};
+
+typedef std::array<int64_t, NUM_COUNTERS> counter_values;
+
+// File descriptors of the open counters, -1 where unavailable
+typedef std::array<int, NUM_COUNTERS> perf_counters;
+
+counter_values empty_counter_values() {
+    counter_values values;
+    values.fill(-1);
+    return values;
+}
+
+// Opens and starts the counters for the calling thread
+perf_counters start_counters() {
+    perf_counters counters;
+    counters.fill(-1);
+
+#ifdef __linux__
+    const uint64_t configs[NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+    for (size_t idx = 0; idx < NUM_COUNTERS; idx++) {
+	perf_event_attr attr;
+	std::memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = configs[idx];
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	counters[idx] = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (counters[idx] >= 0) {
+	    ioctl(counters[idx], PERF_EVENT_IOC_RESET, 0);
+	    ioctl(counters[idx], PERF_EVENT_IOC_ENABLE, 0);
+	}
+    }
+#endif
+
+    return counters;
+}
+
+// Stops and closes the counters, returning their values
+counter_values stop_counters(perf_counters &counters) {
+    counter_values values = empty_counter_values();
+
+#ifdef __linux__
+    for (size_t idx = 0; idx < NUM_COUNTERS; idx++) {
+	if (counters[idx] >= 0) {
+	    ioctl(counters[idx], PERF_EVENT_IOC_DISABLE, 0);
+	    int64_t value;
+	    if (read(counters[idx], &value, sizeof(value)) == sizeof(value)) {
+		values[idx] = value;
+	    }
+	    close(counters[idx]);
+	    counters[idx] = -1;
+	}
+    }
+#endif
+
+    return values;
+}
+
+// Adds the values of b to a, unavailable counters stay unavailable
+void add_counter_values(counter_values &a, const counter_values &b) {
+    for (size_t idx = 0; idx < NUM_COUNTERS; idx++) {
+	if (b[idx] >= 0) {
+	    a[idx] = a[idx] < 0 ? b[idx] : a[idx] + b[idx];
+	}
+    }
+}
+
+// Formats counter values for logging
+std::string format_counters(const counter_values &values) {
+    std::stringstream formatted;
+
+    for (size_t idx = 0; idx < NUM_COUNTERS; idx++) {
+	formatted << (idx > 0 ? " " : "") << COUNTER_NAMES[idx] << ": ";
+	if (values[idx] >= 0) {
+	    formatted << values[idx];
+	} else {
+	    formatted << "n/a";
+	}
+    }
+
+    if (values[CYCLES] > 0 && values[INSTRUCTIONS] >= 0) {
+	formatted << " ipc: " << (double) values[INSTRUCTIONS] / (double) values[CYCLES];
+    }
+
+    return formatted.str();
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "algo.h"
+
+#include <chrono>
+#include <cstdio>
+#include <sys/resource.h>
+
+// Performance regression tests. Runs a fixed-seed generated graph through
+// the whole pipeline and compares time, peak memory and edges retained
+// against a stored baseline, failing if any of them is worse by more than
+// the tolerance. Each size runs in its own process so peak memory is
+// meaningful, see the perf_tests label in CMakeLists.txt
+//
+// Usage: perf_tests --size N --baseline FILE [--tolerance T] [--update]
+//        perf_tests --size N --write FILE
+//
+// The second form only writes the generated graph, as test input for other
+// binaries
+
+#define PERF_AVG_DEGREE 8
+#define PERF_PARTITIONS 2
+// seconds of timing noise that is never counted as a regression
+#define PERF_TIME_SLACK 0.1
+
+struct perf_result {
+    size_t size = 0;
+    double seconds = 0;
+    size_t peak_kb = 0;
+    size_t edges = 0;
+};
+
+// Generates a graph where most edges are local, plus some long range ones,
+// so that it has plenty of triangles and is far from planar
+edge_list generate_graph(const size_t num_nodes, const size_t avg_degree) {
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<size_t> any_node(0, num_nodes - 1);
+    std::geometric_distribution<size_t> local_offset(0.1);
+    std::uniform_real_distribution<double> coin(0, 1);
+
+    edge_list edges;
+    edges.reserve(num_nodes * avg_degree / 2);
+
+    for (size_t idx = 0; idx < num_nodes * avg_degree / 2; idx++) {
+	const node node_0 = any_node(generator);
+	node node_1;
+	if (coin(generator) < 0.9) {
+	    node_1 = (node_0 + 1 + local_offset(generator)) % num_nodes;
+	} else {
+	    node_1 = any_node(generator);
+	}
+	edges.push_back(std::make_pair(node_0, node_1));
+    }
+
+    return edges;
+}
+
+size_t peak_memory_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Runs the full pipeline, the same steps main takes
+perf_result run_pipeline(const size_t size, counter_values &counters) {
+    perf_result result;
+    result.size = size;
+
+    const edge_list edges = generate_graph(size, PERF_AVG_DEGREE);
+    std::unordered_map<node, std::string> labels;
+    for (size_t idx = 0; idx < size; idx++) {
+	labels[idx] = std::to_string(idx);
+    }
+    const std::string output_path = "perf_tests_output_" + std::to_string(size) + ".txt";
+
+    perf_counters perf = start_counters();
+    auto start = std::chrono::high_resolution_clock::now();
+
+    adjacency_list input_graph = to_adj_list(edges);
+    adjacency_list result_graph = algo_routine(input_graph, PERF_PARTITIONS);
+    dedup(result_graph);
+    if (!boyer_myrvold_test(result_graph)) {
+	std::cerr << "ERROR: the result graph is not planar\n";
+	exit(EXIT_FAILURE);
+    }
+    write_graph(result_graph, labels, output_path);
+
+    auto finish = std::chrono::high_resolution_clock::now();
+    counters = stop_counters(perf);
+    std::remove(output_path.c_str());
+
+    result.seconds = std::chrono::duration<double>(finish - start).count();
+    result.peak_kb = peak_memory_kb();
+    result.edges = num_edges(result_graph);
+
+    return result;
+}
+
+// Reads the baselines, one line per size: size seconds peak_kb edges
+std::vector<perf_result> read_baselines(const std::string &file_path) {
+    std::vector<perf_result> baselines;
+    std::ifstream file_in(file_path);
+    std::string line;
+
+    while (getline(file_in, line)) {
+	std::vector<std::string> elements = parse_line(line);
+	if (elements.size() == 4 && elements.at(0).at(0) != '#') {
+	    perf_result baseline;
+	    baseline.size = std::stoull(elements.at(0));
+	    baseline.seconds = std::stod(elements.at(1));
+	    baseline.peak_kb = std::stoull(elements.at(2));
+	    baseline.edges = std::stoull(elements.at(3));
+	    baselines.push_back(baseline);
+	}
+    }
+
+    return baselines;
+}
+
+void write_baselines(const std::string &file_path, const std::vector<perf_result> &baselines) {
+    std::ofstream file_out(file_path);
+    file_out << "# size seconds peak_kb edges_retained\n";
+    for (const perf_result &baseline : baselines) {
+	file_out << baseline.size << " " << baseline.seconds << " " << baseline.peak_kb
+	    << " " << baseline.edges << "\n";
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t size = 0;
+    std::string baseline_path;
+    double tolerance = 0.25;
+    bool update = false;
+    std::string write_path;
+
+    for (int idx = 1; idx < argc; idx++) {
+	const std::string arg = argv[idx];
+	if (arg == "--size" && idx + 1 < argc) {
+	    size = std::stoull(argv[++idx]);
+	} else if (arg == "--baseline" && idx + 1 < argc) {
+	    baseline_path = argv[++idx];
+	} else if (arg == "--tolerance" && idx + 1 < argc) {
+	    tolerance = std::stod(argv[++idx]);
+	} else if (arg == "--update") {
+	    update = true;
+	} else if (arg == "--write" && idx + 1 < argc) {
+	    write_path = argv[++idx];
+	} else {
+	    std::cerr << "Unknown argument: " << arg << "\n";
+	    return 2;
+	}
+    }
+
+    if (size > 0 && !write_path.empty()) {
+	std::ofstream file_out(write_path);
+	for (std::pair<node, node> edge : generate_graph(size, PERF_AVG_DEGREE)) {
+	    file_out << edge.first << " " << edge.second << "\n";
+	}
+	return file_out ? 0 : 1;
+    }
+
+    if (size == 0 || baseline_path.empty()) {
+	std::cerr << "Usage: perf_tests --size N --baseline FILE [--tolerance T] [--update]\n";
+	std::cerr << "       perf_tests --size N --write FILE\n";
+	return 2;
+    }
+
+    counter_values counters;
+    const perf_result result = run_pipeline(size, counters);
+
+    std::cout << "size: " << result.size << " seconds: " << result.seconds
+	<< " peak_kb: " << result.peak_kb << " edges: " << result.edges << "\n";
+    std::cout << format_counters(counters) << "\n";
+
+    std::vector<perf_result> baselines = read_baselines(baseline_path);
+    auto search = std::find_if(baselines.begin(), baselines.end(),
+	    [&](const perf_result &baseline) { return baseline.size == size; });
+
+    if (update) {
+	if (search != baselines.end()) {
+	    *search = result;
+	} else {
+	    baselines.push_back(result);
+	}
+	std::sort(baselines.begin(), baselines.end(),
+		[](const perf_result &a, const perf_result &b) { return a.size < b.size; });
+	write_baselines(baseline_path, baselines);
+	std::cout << "Updated baseline in " << baseline_path << "\n";
+	return 0;
+    }
+
+    if (search == baselines.end()) {
+	std::cout << "No baseline for size " << size << ", nothing to compare\n";
+	return 0;
+    }
+
+    bool passed = true;
+    if (result.seconds > search->seconds * (1 + tolerance) + PERF_TIME_SLACK) {
+	std::cout << "FAIL time: " << result.seconds << "s, baseline " << search->seconds << "s\n";
+	passed = false;
+    }
+    if (result.peak_kb > search->peak_kb * (1 + tolerance)) {
+	std::cout << "FAIL peak memory: " << result.peak_kb << "KB, baseline "
+	    << search->peak_kb << "KB\n";
+	passed = false;
+    }
+    if (result.edges < search->edges * (1 - tolerance)) {
+	std::cout << "FAIL edges retained: " << result.edges << ", baseline "
+	    << search->edges << "\n";
+	passed = false;
+    }
+
+    return passed ? 0 : 1;
+}
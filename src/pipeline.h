@@ -0,0 +1,176 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "utils.h"
+
+#include <atomic>
+#include <thread>
+
+#define PIPELINE_BATCH_SIZE 4096
+#define PIPELINE_QUEUE_CAPACITY 16
+
+// A bounded single producer, single consumer queue. Neither side ever
+// takes a lock, a full or empty queue just yields until the other side
+// catches up. The producer closes the queue once it is done
+template <typename T>
+class spsc_queue {
+public:
+    explicit spsc_queue(const size_t capacity) : slots(capacity + 1) {}
+
+    bool try_push(T &item) {
+	const size_t tail = tail_idx.load(std::memory_order_relaxed);
+	const size_t next = (tail + 1) % slots.size();
+	if (next == head_idx.load(std::memory_order_acquire)) {
+	    return false;
+	}
+	slots[tail] = std::move(item);
+	tail_idx.store(next, std::memory_order_release);
+	return true;
+    }
+
+    bool try_pop(T &item) {
+	const size_t head = head_idx.load(std::memory_order_relaxed);
+	if (head == tail_idx.load(std::memory_order_acquire)) {
+	    return false;
+	}
+	item = std::move(slots[head]);
+	head_idx.store((head + 1) % slots.size(), std::memory_order_release);
+	return true;
+    }
+
+    void push(T item) {
+	while (!try_push(item)) {
+	    std::this_thread::yield();
+	}
+    }
+
+    // Waits for an item, returns false once the queue is closed and empty
+    bool pop(T &item) {
+	while (!try_pop(item)) {
+	    if (closed.load(std::memory_order_acquire)) {
+		// items pushed before close are visible now
+		return try_pop(item);
+	    }
+	    std::this_thread::yield();
+	}
+	return true;
+    }
+
+    void close() {
+	closed.store(true, std::memory_order_release);
+    }
+
+private:
+    std::vector<T> slots;
+    alignas(64) std::atomic<size_t> head_idx {0};
+    alignas(64) std::atomic<size_t> tail_idx {0};
+    std::atomic<bool> closed {false};
+};
+
+typedef std::tuple<adjacency_list, std::unordered_map<std::string, node>,
+	std::unordered_map<node, std::string>> graph_load_result;
+
+// Loads an edge list straight into a deduped adjacency list. Reading lines,
+// tokenizing, interning labels and building the adjacency list each run on
+// their own thread, passing batches through bounded queues, so the stages
+// overlap and the edges are never held as a whole edge list. Node ids are
+// assigned in order of first appearance, the same as load_edge_list
+graph_load_result load_graph(const std::string file_path, uint64_t *content_hash = nullptr) {
+    typedef std::vector<std::pair<std::string, std::string>> label_batch;
+
+    spsc_queue<std::vector<std::string>> lines(PIPELINE_QUEUE_CAPACITY);
+    spsc_queue<label_batch> labeled_edges(PIPELINE_QUEUE_CAPACITY);
+    spsc_queue<edge_list> edges(PIPELINE_QUEUE_CAPACITY);
+
+    std::unordered_map<std::string, node> node_ids;
+    std::unordered_map<node, std::string> node_ids_rev;
+    adjacency_list adj_list;
+
+    std::thread reader([&]() {
+	std::unique_ptr<std::istream> file_in = open_input(file_path);
+	std::vector<std::string> batch;
+	batch.reserve(PIPELINE_BATCH_SIZE);
+	std::string line;
+	uint64_t hash = HASH_SEED;
+
+	while (getline(*file_in, line)) {
+	    hash = hash_line(line, hash);
+	    batch.push_back(std::move(line));
+	    if (batch.size() == PIPELINE_BATCH_SIZE) {
+		lines.push(std::move(batch));
+		batch = std::vector<std::string>();
+		batch.reserve(PIPELINE_BATCH_SIZE);
+	    }
+	}
+	if (!batch.empty()) {
+	    lines.push(std::move(batch));
+	}
+	if (content_hash != nullptr) {
+	    *content_hash = hash;
+	}
+	lines.close();
+    });
+
+    std::thread tokenizer([&]() {
+	std::vector<std::string> batch;
+	while (lines.pop(batch)) {
+	    label_batch labels_out;
+	    labels_out.reserve(batch.size());
+	    for (const std::string &line : batch) {
+		std::vector<std::string> elements = parse_line(line);
+		if (elements.size() > 1) {
+		    labels_out.push_back(std::make_pair(std::move(elements.at(0)),
+				std::move(elements.at(1))));
+		}
+	    }
+	    labeled_edges.push(std::move(labels_out));
+	}
+	labeled_edges.close();
+    });
+
+    std::thread interner([&]() {
+	size_t current_node_id = 0;
+	auto intern = [&](std::string &label) {
+	    auto search = node_ids.find(label);
+	    if (search != node_ids.end()) {
+		return search->second;
+	    }
+	    node_ids_rev[current_node_id] = label;
+	    node_ids.insert({std::move(label), current_node_id});
+	    return current_node_id++;
+	};
+
+	label_batch batch;
+	while (labeled_edges.pop(batch)) {
+	    edge_list edges_out;
+	    edges_out.reserve(batch.size());
+	    for (auto &[label_0, label_1] : batch) {
+		const node node_0 = intern(label_0);
+		const node node_1 = intern(label_1);
+		edges_out.push_back(std::make_pair(node_0, node_1));
+	    }
+	    edges.push(std::move(edges_out));
+	}
+	edges.close();
+    });
+
+    edge_list batch;
+    while (edges.pop(batch)) {
+	for (std::pair<node, node> edge : batch) {
+	    if (edge.first != edge.second) {
+		adj_list[edge.first].push_back(edge.second);
+		adj_list[edge.second].push_back(edge.first);
+	    }
+	}
+    }
+
+    reader.join();
+    tokenizer.join();
+    interner.join();
+
+    dedup(adj_list);
+
+    return std::make_tuple(std::move(adj_list), std::move(node_ids), std::move(node_ids_rev));
+}
+
+#endif
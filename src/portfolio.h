@@ -0,0 +1,145 @@
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include "algo.h"
+
+// Portfolio mode. Runs several differently configured copies of the
+// algorithm in parallel on the same read-only graph and keeps the result
+// with the most edges. Runs that can no longer beat the best finished run
+// are stopped early
+
+// Makes the configurations of a portfolio of num_runs runs. The first is
+// always the default configuration, so a portfolio never does worse than a
+// plain run with a single partition. Settings that don't change the search
+// and the profiling outputs are taken from base
+std::vector<algo_options> make_portfolio(const size_t num_runs, const algo_options &base) {
+    std::vector<algo_options> configs;
+    const size_t partition_counts[] = {1, 2, 4};
+
+    for (size_t idx = 0; idx < num_runs; idx++) {
+	algo_options config;
+	config.time_limit = base.time_limit;
+	config.nodes_covered = base.nodes_covered;
+	config.bridges = base.bridges;
+	config.pin_threads = base.pin_threads;
+	config.thread_counters = base.thread_counters;
+	config.thread_numa_nodes = base.thread_numa_nodes;
+	config.support_histogram = base.support_histogram;
+	config.support_threads = base.support_threads;
+	config.dense_max_nodes = base.dense_max_nodes;
+	config.num_partitions = 1;
+
+	if (idx > 0) {
+	    std::mt19937 generator(base.seed + idx);
+	    config.seed = base.seed + idx;
+	    config.random_start = idx % 2 == 1;
+	    // keep the default order now and then, so the other settings are
+	    // tried on their own as well
+	    if (idx % 3 != 0) {
+		std::shuffle(config.order.begin(), config.order.end(), generator);
+	    }
+	    config.num_partitions = partition_counts[(idx / 2) % 3];
+	}
+
+	configs.push_back(config);
+    }
+
+    return configs;
+}
+
+// Runs the portfolio with up to threads runs at a time, each on one thread.
+// Sets winner, if given, to the index of the configuration that won. Ties
+// go to the lower index, so the result doesn't depend on timing. The
+// coverage and bridges of the winning run go to the first config's
+// nodes_covered and bridges. The first config's pinning and profiling
+// outputs are per portfolio thread, counting every run on that thread
+template <typename G>
+adjacency_list portfolio_routine(const G &adj_list, const std::vector<algo_options> &configs,
+	const int threads, size_t *winner = nullptr) {
+    std::atomic<size_t> best_edges {0};
+    adjacency_list best_result;
+    size_t best_idx = configs.size();
+    size_t best_covered = 0;
+    edge_list best_bridges;
+
+    // the runs are nested in the portfolio's threads, where they would all
+    // see thread 0, so threads are pinned and profiled here instead
+    const algo_options base = configs.empty() ? algo_options() : configs.front();
+    if (base.thread_counters != nullptr) {
+	base.thread_counters->assign(threads, empty_counter_values());
+    }
+    if (base.thread_numa_nodes != nullptr) {
+	base.thread_numa_nodes->assign(threads, 0);
+    }
+    std::vector<int> cpus;
+    if (base.pin_threads) {
+	cpus = get_allowed_cpus();
+    }
+
+#pragma omp parallel num_threads(threads)
+    {
+	// unpinned when the region ends
+	std::optional<thread_pin> pin;
+	if (!cpus.empty()) {
+	    pin.emplace(cpus.at(omp_get_thread_num() % cpus.size()));
+	}
+	if (base.thread_numa_nodes != nullptr) {
+	    base.thread_numa_nodes->at(omp_get_thread_num()) = current_numa_node();
+	}
+
+#pragma omp for schedule(dynamic, 1)
+	for (size_t idx = 0; idx < configs.size(); idx++) {
+	    run_progress progress;
+	    progress.num_nodes = num_nodes(adj_list);
+	    progress.best_edges = &best_edges;
+
+	    algo_options config = configs.at(idx);
+	    size_t run_covered = 0;
+	    edge_list run_bridges;
+	    std::vector<counter_values> run_counters;
+	    config.progress = &progress;
+	    config.nodes_covered = &run_covered;
+	    config.bridges = &run_bridges;
+	    config.thread_counters = base.thread_counters != nullptr ? &run_counters : nullptr;
+	    config.thread_numa_nodes = nullptr;
+
+	    adjacency_list result = algo_routine(adj_list, 1, config);
+	    if (base.thread_counters != nullptr) {
+		add_counter_values(base.thread_counters->at(omp_get_thread_num()),
+			run_counters.at(0));
+	    }
+	    if (progress.cannot_win()) {
+		continue;
+	    }
+	    dedup(result);
+	    const size_t result_edges = num_edges(result);
+
+#pragma omp critical(portfolio_best)
+	    {
+		if (result_edges > best_edges ||
+			(result_edges == best_edges && idx < best_idx)) {
+		    best_edges = result_edges;
+		    best_result = std::move(result);
+		    best_idx = idx;
+		    best_covered = run_covered;
+		    best_bridges = std::move(run_bridges);
+		}
+	    }
+	}
+    }
+
+    if (winner != nullptr) {
+	*winner = best_idx;
+    }
+    if (!configs.empty() && configs.front().nodes_covered != nullptr) {
+	*configs.front().nodes_covered += best_covered;
+    }
+    if (!configs.empty() && configs.front().bridges != nullptr) {
+	configs.front().bridges->insert(configs.front().bridges->end(), best_bridges.begin(),
+		best_bridges.end());
+    }
+
+    return best_result;
+}
+
+#endif
@@ -0,0 +1,171 @@
+#include "algo.h"
+#include "csr_graph.h"
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+// Python bindings. A SciPy CSR adjacency matrix that is already a simple
+// undirected graph, symmetric with sorted rows and no self loops, is read
+// in place through csr_graph, without copying its arrays. Other matrices,
+// and (m, 2) NumPy arrays of edges, are first built into a CSR graph of
+// their own. The algorithm runs with the GIL released, and the retained
+// edges are returned as an (m, 2) int64 array
+//
+// >>> import planarityfilter
+// >>> retained = planarityfilter.planarize(edges, threads=4)
+
+namespace py = pybind11;
+
+// Runs the algorithm and validates the result, called without the GIL
+template <typename G>
+adjacency_list run_planarize(const G &graph, const int threads) {
+    adjacency_list result = algo_routine(graph, threads);
+    dedup(result);
+
+    if (!boyer_myrvold_test(result)) {
+	throw std::runtime_error("the result graph is not planar");
+    }
+
+    return result;
+}
+
+// Copies the result edges out into a new (m, 2) array, smaller node first
+py::array_t<int64_t> to_edge_array(const adjacency_list &result) {
+    size_t num_result_edges = 0;
+    for (auto &[key_node, adjs] : result) {
+	for (node adj : adjs) {
+	    num_result_edges += key_node < adj;
+	}
+    }
+
+    py::array_t<int64_t> edges_out({num_result_edges, (size_t) 2});
+    auto edges_view = edges_out.mutable_unchecked<2>();
+    size_t idx = 0;
+    for (auto &[key_node, adjs] : result) {
+	for (node adj : adjs) {
+	    if (key_node < adj) {
+		edges_view(idx, 0) = (int64_t) key_node;
+		edges_view(idx, 1) = (int64_t) adj;
+		idx++;
+	    }
+	}
+    }
+
+    return edges_out;
+}
+
+// Planarizes a graph given as an (m, 2) array of node ids. The edges are
+// read from the array where it is already C contiguous int64, and built
+// into a CSR graph with a row for every id up to the largest
+py::array_t<int64_t> planarize(const py::array_t<int64_t, py::array::c_style> &edges,
+	const int threads) {
+    if (edges.ndim() != 2 || edges.shape(1) != 2) {
+	throw py::value_error("edges must be an (m, 2) array");
+    }
+
+    auto edges_view = edges.unchecked<2>();
+    int64_t max_id = -1;
+    for (py::ssize_t idx = 0; idx < edges_view.shape(0); idx++) {
+	if (edges_view(idx, 0) < 0 || edges_view(idx, 1) < 0) {
+	    throw py::value_error("node ids must not be negative");
+	}
+	max_id = std::max({max_id, edges_view(idx, 0), edges_view(idx, 1)});
+    }
+
+    adjacency_list result;
+    {
+	py::gil_scoped_release release;
+	const csr_graph<int64_t> graph = make_csr<int64_t>(max_id + 1, edges_view.shape(0),
+		[&](const size_t idx) {
+		    return std::make_pair((node) edges_view(idx, 0), (node) edges_view(idx, 1));
+		});
+	result = run_planarize(graph, threads);
+    }
+
+    return to_edge_array(result);
+}
+
+// Planarizes a graph given as a CSR adjacency matrix through its indptr and
+// indices arrays, every stored entry is an edge. The arrays are read in
+// place if they are a simple undirected graph, and copied otherwise
+template <typename I>
+py::array_t<int64_t> planarize_csr_arrays(const py::array_t<I, py::array::c_style> &indptr,
+	const py::array_t<I, py::array::c_style> &indices, const int threads) {
+    if (!indptr || !indices) {
+	throw py::value_error("indptr and indices must be integer arrays");
+    }
+    if (indptr.ndim() != 1 || indices.ndim() != 1 || indptr.shape(0) < 1) {
+	throw py::value_error("indptr and indices must be 1-dimensional");
+    }
+
+    const I *indptr_data = indptr.data();
+    const I *indices_data = indices.data();
+    const size_t num_rows = indptr.shape(0) - 1;
+    const size_t num_indices = indices.shape(0);
+    for (size_t row = 0; row < num_rows; row++) {
+	if (indptr_data[row] < 0 || indptr_data[row + 1] < indptr_data[row] ||
+		(size_t) indptr_data[row + 1] > num_indices) {
+	    throw py::value_error("indptr is out of range of indices");
+	}
+    }
+    for (size_t idx = 0; idx < (size_t) indptr_data[num_rows]; idx++) {
+	if (indices_data[idx] < 0 || (size_t) indices_data[idx] >= num_rows) {
+	    throw py::value_error("column indices must be rows of the matrix");
+	}
+    }
+
+    adjacency_list result;
+    {
+	py::gil_scoped_release release;
+	if (is_simple_csr(indptr_data, indices_data, num_rows, num_indices)) {
+	    csr_graph<I> graph;
+	    graph.indptr = indptr_data;
+	    graph.indices = indices_data;
+	    graph.num_rows = num_rows;
+	    result = run_planarize(graph, threads);
+	} else {
+	    // the row of each stored entry, to give make_csr the entries as
+	    // edges without another copy of the indices
+	    std::vector<node> entry_rows(indptr_data[num_rows]);
+	    for (size_t row = 0; row < num_rows; row++) {
+		std::fill(entry_rows.begin() + indptr_data[row],
+			entry_rows.begin() + indptr_data[row + 1], (node) row);
+	    }
+	    const csr_graph<I> graph = make_csr<I>(num_rows, entry_rows.size(),
+		    [&](const size_t idx) {
+			return std::make_pair(entry_rows[idx], (node) indices_data[idx]);
+		    });
+	    std::vector<node>().swap(entry_rows);
+	    result = run_planarize(graph, threads);
+	}
+    }
+
+    return to_edge_array(result);
+}
+
+// Accepts a scipy.sparse CSR matrix, or anything else with indptr and
+// indices arrays. SciPy uses int32 indices unless the matrix is too big
+py::array_t<int64_t> planarize_csr(const py::object &matrix, const int threads) {
+    const py::array indptr = matrix.attr("indptr");
+    const py::array indices = matrix.attr("indices");
+
+    if (indptr.dtype().is(py::dtype::of<int32_t>()) &&
+	    indices.dtype().is(py::dtype::of<int32_t>())) {
+	return planarize_csr_arrays<int32_t>(
+		py::array_t<int32_t, py::array::c_style>::ensure(indptr),
+		py::array_t<int32_t, py::array::c_style>::ensure(indices), threads);
+    }
+    return planarize_csr_arrays<int64_t>(py::array_t<int64_t, py::array::c_style>::ensure(indptr),
+	    py::array_t<int64_t, py::array::c_style>::ensure(indices), threads);
+}
+
+PYBIND11_MODULE(planarityfilter, module) {
+    module.doc() = "Planar approximations of large graphs through graphlet edge addition";
+
+    module.def("planarize", &planarize, py::arg("edges"), py::arg("threads") = 1,
+	    "Returns the edges of a planar subgraph of the graph given by an (m, 2) "
+	    "integer array of edges, as an (k, 2) int64 array");
+    module.def("planarize_csr", &planarize_csr, py::arg("matrix"), py::arg("threads") = 1,
+	    "Returns the edges of a planar subgraph of the graph given by a "
+	    "scipy.sparse CSR adjacency matrix, as an (k, 2) int64 array");
+}
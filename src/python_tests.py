@@ -0,0 +1,66 @@
+# Smoke test of the Python module, run by ctest -L python with the module's
+# build directory on PYTHONPATH. Exits non-zero on the first failure
+
+import numpy as np
+
+import planarityfilter
+
+
+def clique_edges(first, size):
+    return [(n, m) for n in range(first, first + size) for m in range(n + 1, first + size)]
+
+
+def check_planar_subgraph(retained, edges):
+    assert retained.dtype == np.int64 and retained.ndim == 2 and retained.shape[1] == 2
+    edge_set = {tuple(sorted(edge)) for edge in edges}
+    assert all(tuple(sorted(edge)) in edge_set for edge in retained.tolist())
+    # a simple planar graph has at most 3n - 6 edges
+    num_nodes = len({node for edge in edges for node in edge})
+    assert len(retained) <= 3 * num_nodes - 6
+
+
+def test_planarize():
+    edges = clique_edges(0, 6) + clique_edges(6, 5) + [(5, 6)]
+    retained = planarityfilter.planarize(np.array(edges, dtype=np.int64), threads=2)
+    check_planar_subgraph(retained, edges)
+    # the bridge between the cliques is always kept
+    assert [5, 6] in retained.tolist()
+
+    # other dtypes are converted
+    retained = planarityfilter.planarize(np.array(edges, dtype=np.int32))
+    check_planar_subgraph(retained, edges)
+
+    try:
+        planarityfilter.planarize(np.array([0, 1, 2], dtype=np.int64))
+        assert False, "expected a ValueError"
+    except ValueError:
+        pass
+
+
+def test_planarize_csr():
+    try:
+        import scipy.sparse
+    except ImportError:
+        print("scipy not found, skipping planarize_csr")
+        return
+
+    edges = clique_edges(0, 6) + [(5, 6), (6, 7), (7, 5)]
+    rows = [edge[0] for edge in edges]
+    cols = [edge[1] for edge in edges]
+    ones = np.ones(len(edges))
+
+    # symmetric, read in place
+    matrix = scipy.sparse.csr_matrix((np.concatenate([ones, ones]),
+        (rows + cols, cols + rows)), shape=(8, 8))
+    retained = planarityfilter.planarize_csr(matrix, threads=2)
+    check_planar_subgraph(retained, edges)
+
+    # upper triangle only, copied
+    matrix = scipy.sparse.csr_matrix((ones, (rows, cols)), shape=(8, 8))
+    check_planar_subgraph(planarityfilter.planarize_csr(matrix), edges)
+
+
+if __name__ == "__main__":
+    test_planarize()
+    test_planarize_csr()
+    print("python module tests passed")
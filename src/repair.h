@@ -0,0 +1,125 @@
+#ifndef REPAIR_H
+#define REPAIR_H
+
+#include "blocks.h"
+
+#include "boost/graph/boyer_myrvold_planar_test.hpp"
+
+// Repair of a result that fails the final planarity test, instead of
+// throwing the run away. The graphlets are planar by construction, so the
+// likely culprits are the edges added afterwards to connect components.
+// Only blocks of the result that are non-planar are looked at, as a graph is
+// planar if and only if all of its blocks are. In each of those, a
+// Kuratowski subgraph (a subdivision of K5 or K3,3) is extracted and one of
+// its edges removed, which breaks that subgraph, until the block is planar.
+// Added edges are removed first, other edges only if a Kuratowski subgraph
+// has none of them
+
+struct repair_stats {
+    size_t nonplanar_blocks = 0;
+    // removed edges that were added to connect components
+    size_t removed_added = 0;
+    // removed edges from the graphlets, when no added edge could break a
+    // Kuratowski subgraph
+    size_t removed_other = 0;
+    edge_list removed;
+};
+
+// Finds the edges of a Kuratowski subgraph of a graph with ids 0..n-1.
+// Returns no edges if the graph is planar
+edge_list find_kuratowski_edges(const adjacency_list &adj_list) {
+    typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS,
+	    boost::property<boost::vertex_index_t, int>,
+	    boost::property<boost::edge_index_t, int>> kuratowski_graph;
+
+    kuratowski_graph graph(adj_list.size());
+    for (auto &[key_node, adjs] : adj_list) {
+	for (node adj : adjs) {
+	    if (key_node < adj) {
+		boost::add_edge(key_node, adj, graph);
+	    }
+	}
+    }
+
+    int edge_idx = 0;
+    auto edge_index = boost::get(boost::edge_index, graph);
+    for (auto edge : boost::make_iterator_range(boost::edges(graph))) {
+	boost::put(edge_index, edge, edge_idx++);
+    }
+
+    std::vector<boost::graph_traits<kuratowski_graph>::edge_descriptor> kuratowski;
+    const bool planar = boost::boyer_myrvold_planarity_test(
+	    boost::boyer_myrvold_params::graph = graph,
+	    boost::boyer_myrvold_params::kuratowski_subgraph = std::back_inserter(kuratowski));
+
+    edge_list edges;
+    if (!planar) {
+	for (auto edge : kuratowski) {
+	    edges.push_back(std::make_pair(boost::source(edge, graph), boost::target(edge, graph)));
+	}
+    }
+    return edges;
+}
+
+// Removes edges from result until it is planar, preferring those in added.
+// Returns what was removed
+repair_stats repair_planarity(adjacency_list &result, const edge_list &added) {
+    repair_stats stats;
+    std::unordered_set<std::pair<node, node>, edge_hash> added_set;
+    for (std::pair<node, node> edge : added) {
+	added_set.insert(std::minmax(edge.first, edge.second));
+    }
+
+    std::vector<edge_list> blocks;
+    for (const std::vector<node> &component : get_components(result)) {
+	for (edge_list &block : find_blocks(component.front(), result)) {
+	    // blocks under 9 edges are always planar (K3,3 has 9, K5 has 10)
+	    if (block.size() >= 9) {
+		blocks.push_back(std::move(block));
+	    }
+	}
+    }
+
+    for (const edge_list &block_edges : blocks) {
+	graph_block block = make_block(block_edges);
+	dedup(block.adj_list);
+	edge_list kuratowski = find_kuratowski_edges(block.adj_list);
+	if (kuratowski.empty()) {
+	    continue;
+	}
+	stats.nonplanar_blocks++;
+
+	// removing edges can only make the rest of the block more planar, so
+	// it is retested on its own until it passes
+	while (!kuratowski.empty()) {
+	    std::pair<node, node> remove = kuratowski.front();
+	    bool is_added = false;
+	    for (std::pair<node, node> edge : kuratowski) {
+		const std::pair<node, node> global = std::minmax(block.nodes.at(edge.first),
+			block.nodes.at(edge.second));
+		if (added_set.count(global) > 0) {
+		    remove = edge;
+		    is_added = true;
+		    break;
+		}
+	    }
+
+	    const node node_0 = block.nodes.at(remove.first);
+	    const node node_1 = block.nodes.at(remove.second);
+	    remove_edge(block.adj_list, remove.first, remove.second);
+	    remove_edge(result, node_0, node_1);
+	    stats.removed.push_back(std::make_pair(node_0, node_1));
+	    if (is_added) {
+		stats.removed_added++;
+	    } else {
+		stats.removed_other++;
+	    }
+
+	    kuratowski = find_kuratowski_edges(block.adj_list);
+	}
+    }
+
+    return stats;
+}
+
+#endif
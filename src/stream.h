@@ -0,0 +1,315 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "trace.h"
+#include "writer.h"
+
+#include <random>
+
+// Semi-streaming planarizer. Reads the edges once, in the order they arrive,
+// and decides on each one straight away, keeping O(n) state and a bounded
+// reservoir of edges that may become acceptable later. The output is kept a
+// cactus, where every edge is on at most one cycle, which is always planar:
+//
+// - an edge between two components of the output is a bridge, found with
+//   union-find, and joining two planar graphs with an edge keeps them planar
+// - an edge u-v inside a component is accepted if there is a node w where
+//   u-w and w-v are both bridges. u-w-v is then the only path from u to v,
+//   so the edge only closes the triangle u-v-w
+// - other edges inside a component go to a bounded reservoir. Once the
+//   stream ends, reservoir edges whose endpoints are joined by a short path
+//   of bridges close that path into a cycle, shortest cycles first. Closing
+//   them during the stream would use up bridges that later triangles need
+//
+// Each accepted edge is written as soon as it is accepted. A cactus has at
+// most 3(n - 1)/2 edges, so compared to algo_routine, which nests graphlets,
+// results retain fewer edges on dense graphs, in exchange for one pass and
+// no whole graph in memory
+
+// Default number of rejected edges kept for another try at the end
+#define STREAM_RESERVOIR_SIZE 1000000
+// Accepted edges between flushes of the output
+#define STREAM_FLUSH_EDGES 4096
+// Longest cycle closed by a reservoir edge
+#define STREAM_MAX_CYCLE 6
+// Nodes visited looking for a path of bridges, so hubs stay cheap
+#define STREAM_SEARCH_LIMIT 256
+
+struct stream_state {
+    std::unordered_map<std::string, node> node_ids;
+    std::vector<std::string> labels;
+    disjoint_sets components;
+    std::vector<std::vector<node>> adjs;
+    // adjacents through edges that are still bridges
+    std::vector<std::vector<node>> bridges;
+    // accepted edges, smaller node first, mapped to whether they are on a
+    // cycle
+    std::unordered_map<std::pair<node, node>, bool, edge_hash> accepted;
+    // edges within a component that couldn't close a triangle, sampled
+    // uniformly once there are more than fit
+    edge_list reservoir;
+    size_t reservoir_capacity = STREAM_RESERVOIR_SIZE;
+    size_t num_offered = 0;
+    std::mt19937_64 generator {42};
+    // BFS parents, valid where search_mark is the current search
+    std::vector<node> search_parent;
+    std::vector<size_t> search_mark;
+    size_t search_epoch = 0;
+};
+
+// Stats of a streaming run, for the log
+struct stream_stats {
+    size_t edges_read = 0;
+    size_t accepted = 0;
+    size_t reservoir_accepted = 0;
+};
+
+// Splits the first two whitespace separated fields off a line, the same
+// fields parse_line gives, without a regex. Returns false for lines with
+// fewer than two
+bool split_edge(const std::string &line, std::string &label_0, std::string &label_1) {
+    const char *whitespace = " \t\r\n\v\f";
+    const size_t start_0 = line.find_first_not_of(whitespace);
+    if (start_0 == std::string::npos) {
+	return false;
+    }
+    const size_t end_0 = line.find_first_of(whitespace, start_0);
+    const size_t start_1 = end_0 == std::string::npos ? end_0 :
+	line.find_first_not_of(whitespace, end_0);
+    if (start_1 == std::string::npos) {
+	return false;
+    }
+    const size_t end_1 = line.find_first_of(whitespace, start_1);
+
+    label_0.assign(line, start_0, end_0 - start_0);
+    label_1.assign(line, start_1, end_1 == std::string::npos ? end_1 : end_1 - start_1);
+    return true;
+}
+
+node intern_label(stream_state &state, const std::string &label) {
+    auto search = state.node_ids.find(label);
+    if (search != state.node_ids.end()) {
+	return search->second;
+    }
+
+    const node id = state.labels.size();
+    state.node_ids.insert({label, id});
+    state.labels.push_back(label);
+    state.adjs.emplace_back();
+    state.bridges.emplace_back();
+    state.components.parent.push_back(id);
+    state.components.size.push_back(1);
+    state.search_parent.push_back(id);
+    state.search_mark.push_back(0);
+    return id;
+}
+
+// Adds an accepted edge to the output
+void accept_edge(stream_state &state, const node node_0, const node node_1,
+	const bool on_cycle) {
+    state.accepted.insert({std::minmax(node_0, node_1), on_cycle});
+    state.adjs.at(node_0).push_back(node_1);
+    state.adjs.at(node_1).push_back(node_0);
+    if (!on_cycle) {
+	state.bridges.at(node_0).push_back(node_1);
+	state.bridges.at(node_1).push_back(node_0);
+    }
+}
+
+// Marks a bridge as being on a cycle now
+void close_bridge(stream_state &state, const node node_0, const node node_1) {
+    state.accepted.at(std::minmax(node_0, node_1)) = true;
+    for (auto [this_node, other] : {std::make_pair(node_0, node_1), std::make_pair(node_1, node_0)}) {
+	std::vector<node> &these_bridges = state.bridges.at(this_node);
+	these_bridges.erase(std::find(these_bridges.begin(), these_bridges.end(), other));
+    }
+}
+
+// Accepts the edge if it joins two components or closes a triangle
+bool try_accept(stream_state &state, const node node_0, const node node_1) {
+    const std::pair<node, node> key = std::minmax(node_0, node_1);
+    if (node_0 == node_1 || state.accepted.count(key) > 0) {
+	return false;
+    }
+
+    bool on_cycle = false;
+    if (!union_sets(state.components, node_0, node_1)) {
+	// look for w among the bridges of the endpoint with fewer
+	const node near = state.bridges.at(node_0).size() <= state.bridges.at(node_1).size() ?
+	    node_0 : node_1;
+	const node far = near == node_0 ? node_1 : node_0;
+
+	for (node w : state.bridges.at(near)) {
+	    auto far_edge = state.accepted.find(std::minmax(w, far));
+	    if (far_edge != state.accepted.end() && !far_edge->second) {
+		close_bridge(state, near, w);
+		close_bridge(state, w, far);
+		on_cycle = true;
+		break;
+	    }
+	}
+
+	if (!on_cycle) {
+	    return false;
+	}
+    }
+
+    accept_edge(state, node_0, node_1, on_cycle);
+    return true;
+}
+
+// Finds the length of the path of bridges from node_0 to node_1, if there
+// is one of at most max_length, and 0 otherwise. Every path between them
+// then has to cross all of those bridges, so the path is the only one and
+// an edge between them closes a single cycle. The path is found by a BFS
+// over bridges, which form a forest, and can be followed back from node_1
+// through search_parent
+size_t bridge_path_length(stream_state &state, const node node_0, const node node_1,
+	const size_t max_length) {
+    state.search_epoch++;
+    state.search_mark.at(node_0) = state.search_epoch;
+    std::vector<node> frontier {node_0};
+    size_t visited = 1;
+
+    for (size_t depth = 1; depth <= max_length && !frontier.empty(); depth++) {
+	std::vector<node> next_frontier;
+	for (node this_node : frontier) {
+	    for (node adj : state.bridges.at(this_node)) {
+		if (state.search_mark.at(adj) == state.search_epoch) {
+		    continue;
+		}
+		state.search_mark.at(adj) = state.search_epoch;
+		state.search_parent.at(adj) = this_node;
+		if (adj == node_1) {
+		    return depth;
+		}
+		next_frontier.push_back(adj);
+		visited++;
+	    }
+	    if (visited > STREAM_SEARCH_LIMIT) {
+		return 0;
+	    }
+	}
+	frontier.swap(next_frontier);
+    }
+
+    return 0;
+}
+
+// Accepts the edge if its endpoints are joined by a path of at most
+// max_length bridges, closing it into a cycle
+bool try_accept_cycle(stream_state &state, const node node_0, const node node_1,
+	const size_t max_length) {
+    if (state.accepted.count(std::minmax(node_0, node_1)) > 0 ||
+	    bridge_path_length(state, node_0, node_1, max_length) == 0) {
+	return false;
+    }
+
+    for (node this_node = node_1; this_node != node_0;) {
+	const node parent = state.search_parent.at(this_node);
+	close_bridge(state, this_node, parent);
+	this_node = parent;
+    }
+    accept_edge(state, node_0, node_1, true);
+    return true;
+}
+
+// Keeps a rejected edge for later, replacing a random one once full so the
+// reservoir stays a uniform sample of everything offered
+void offer_reservoir(stream_state &state, const node node_0, const node node_1) {
+    state.num_offered++;
+    if (state.reservoir.size() < state.reservoir_capacity) {
+	state.reservoir.push_back(std::make_pair(node_0, node_1));
+	return;
+    }
+
+    std::uniform_int_distribution<size_t> distribution(0, state.num_offered - 1);
+    const size_t idx = distribution(state.generator);
+    if (idx < state.reservoir_capacity) {
+	state.reservoir.at(idx) = std::make_pair(node_0, node_1);
+    }
+}
+
+// Runs the streaming planarizer from input_path, which may be - for stdin,
+// writing each accepted edge to file_out as it goes. Returns the output as
+// an adjacency list, which is O(n), so it can still be validated
+adjacency_list stream_routine(const std::string &input_path, std::ostream &file_out,
+	const size_t reservoir_capacity, stream_stats &stats) {
+    trace_scope stream_span("stream");
+    stream_state state;
+    state.reservoir_capacity = reservoir_capacity;
+
+    std::unique_ptr<std::istream> file_in = open_input(input_path);
+    std::string buffer;
+    size_t unflushed = 0;
+
+    auto emit = [&](const node node_0, const node node_1) {
+	buffer += state.labels.at(node_0);
+	buffer += ' ';
+	buffer += state.labels.at(node_1);
+	buffer += '\n';
+	// flushed in batches so consumers down a pipe see edges promptly
+	if (++unflushed == STREAM_FLUSH_EDGES) {
+	    file_out.write(buffer.data(), buffer.size());
+	    file_out.flush();
+	    buffer.clear();
+	    unflushed = 0;
+	}
+    };
+
+    std::string line;
+    std::string label_0;
+    std::string label_1;
+    while (getline(*file_in, line)) {
+	if (!split_edge(line, label_0, label_1)) {
+	    continue;
+	}
+	stats.edges_read++;
+
+	const node node_0 = intern_label(state, label_0);
+	const node node_1 = intern_label(state, label_1);
+	if (try_accept(state, node_0, node_1)) {
+	    stats.accepted++;
+	    emit(node_0, node_1);
+	} else if (node_0 != node_1 &&
+		state.accepted.count(std::minmax(node_0, node_1)) == 0) {
+	    offer_reservoir(state, node_0, node_1);
+	}
+    }
+
+    // bridges only ever end up on cycles, so paths only get longer or go
+    // away. The reservoir edges are measured once, those without a short
+    // enough path are dropped, and the rest are tried shortest first
+    std::vector<std::pair<size_t, size_t>> candidates;
+    for (size_t idx = 0; idx < state.reservoir.size(); idx++) {
+	const std::pair<node, node> edge = state.reservoir.at(idx);
+	const size_t length = bridge_path_length(state, edge.first, edge.second,
+		STREAM_MAX_CYCLE - 1);
+	if (length > 0) {
+	    candidates.push_back(std::make_pair(length, idx));
+	}
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    for (auto &[length, idx] : candidates) {
+	const std::pair<node, node> edge = state.reservoir.at(idx);
+	if (try_accept_cycle(state, edge.first, edge.second, length)) {
+	    stats.accepted++;
+	    stats.reservoir_accepted++;
+	    emit(edge.first, edge.second);
+	}
+    }
+    edge_list().swap(state.reservoir);
+
+    file_out.write(buffer.data(), buffer.size());
+    file_out.flush();
+
+    adjacency_list result;
+    result.reserve(state.adjs.size());
+    for (node key_node = 0; key_node < state.adjs.size(); key_node++) {
+	result.insert({key_node, std::move(state.adjs.at(key_node))});
+    }
+    return result;
+}
+
+#endif
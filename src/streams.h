@@ -0,0 +1,124 @@
+#ifndef STREAMS_H
+#define STREAMS_H
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "boost/iostreams/device/file.hpp"
+#include "boost/iostreams/filter/gzip.hpp"
+#include "boost/iostreams/filter/zstd.hpp"
+#include "boost/iostreams/filtering_stream.hpp"
+
+// Input and output streams that transparently handle gzip and zstd
+// compressed files. The format comes from the file extension, and for
+// inputs also from the magic bytes at the start of the file
+
+enum stream_compression { NO_COMPRESSION, GZIP, ZSTD };
+
+bool ends_with(const std::string &a_string, const std::string &suffix) {
+    return a_string.size() >= suffix.size() &&
+        a_string.compare(a_string.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Gets the compression format from the file extension
+stream_compression compression_from_extension(const std::string &file_path) {
+    if (ends_with(file_path, ".gz")) {
+        return GZIP;
+    } else if (ends_with(file_path, ".zst") || ends_with(file_path, ".zstd")) {
+        return ZSTD;
+    }
+    return NO_COMPRESSION;
+}
+
+// Gets the compression format of an existing file from its magic bytes,
+// falling back to the extension if the file can't be read
+stream_compression detect_compression(const std::string &file_path) {
+    std::ifstream file_in(file_path, std::ios::binary);
+    unsigned char magic[4] = {0, 0, 0, 0};
+    file_in.read(reinterpret_cast<char *>(magic), 4);
+
+    if (file_in.gcount() >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return GZIP;
+    } else if (file_in.gcount() == 4 && magic[0] == 0x28 && magic[1] == 0xb5 &&
+            magic[2] == 0x2f && magic[3] == 0xfd) {
+        return ZSTD;
+    } else if (file_in.gcount() > 0) {
+        return NO_COMPRESSION;
+    }
+
+    return compression_from_extension(file_path);
+}
+
+// Opens a file for reading, decompressing it if needed. A file path of
+// "-" reads from stdin. Check the returned stream's state for errors
+std::unique_ptr<std::istream> open_input(const std::string &file_path) {
+    auto stream_in = std::make_unique<boost::iostreams::filtering_istream>();
+
+    if (file_path == "-") {
+        stream_in->push(std::cin);
+        return stream_in;
+    }
+
+    switch (detect_compression(file_path)) {
+        case GZIP:
+            stream_in->push(boost::iostreams::gzip_decompressor());
+            break;
+        case ZSTD:
+            stream_in->push(boost::iostreams::zstd_decompressor());
+            break;
+        case NO_COMPRESSION:
+            break;
+    }
+
+    std::ifstream file_check(file_path);
+    if (!file_check.is_open()) {
+        stream_in->setstate(std::ios::failbit);
+        return stream_in;
+    }
+    file_check.close();
+
+    stream_in->push(boost::iostreams::file_source(file_path, std::ios::in | std::ios::binary));
+    return stream_in;
+}
+
+// Opens a file for writing, compressing it if the extension asks for it.
+// A file path of "-" writes to stdout. The output is complete once the
+// returned stream is destroyed
+std::unique_ptr<std::ostream> open_output(const std::string &file_path) {
+    auto stream_out = std::make_unique<boost::iostreams::filtering_ostream>();
+
+    switch (compression_from_extension(file_path)) {
+        case GZIP:
+            stream_out->push(boost::iostreams::gzip_compressor());
+            break;
+        case ZSTD:
+            stream_out->push(boost::iostreams::zstd_compressor());
+            break;
+        case NO_COMPRESSION:
+            break;
+    }
+
+    if (file_path == "-") {
+        stream_out->push(std::cout);
+    } else {
+        stream_out->push(boost::iostreams::file_sink(file_path, std::ios::out | std::ios::binary));
+    }
+
+    return stream_out;
+}
+
+// Tests whether an output can be written again from the start, which
+// stdout and FIFOs can't as their readers may have consumed it already
+bool output_rewritable(const std::string &file_path) {
+    if (file_path == "-") {
+        return false;
+    }
+    std::error_code err;
+    const std::filesystem::file_status status = std::filesystem::status(file_path, err);
+    return !std::filesystem::exists(status) || std::filesystem::is_regular_file(status);
+}
+
+#endif
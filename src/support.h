@@ -0,0 +1,219 @@
+#ifndef SUPPORT_H
+#define SUPPORT_H
+
+#include "utils.h"
+
+#include <numeric>
+#include <omp.h>
+#include <sstream>
+
+// Triangle support, the number of triangles each edge is in. Every graphlet
+// the search looks for is built around a triangle x-y-z, so an edge x-y with
+// no support can never start one and the search skips it, and a node whose
+// edges all have none is never part of one.
+//
+// Triangles are counted once each by orienting every edge from the lower to
+// the higher ranked endpoint, ranked by degree then id, and intersecting the
+// sorted higher ranked adjacents of both endpoints. That keeps each list
+// O(sqrt(m)) long, so hubs stay cheap. Nodes are counted in parallel
+
+// Buckets of the support histogram, bucket b > 0 holding supports in
+// [2^(b-1), 2^b), the last one everything above
+#define SUPPORT_HISTOGRAM_BUCKETS 12
+
+// The support of each edge, stored per adjacent in the order get_adjs gives
+// them, starting at the node's offset
+struct edge_support {
+    std::unordered_map<node, size_t> offsets;
+    std::vector<uint32_t> counts;
+    // nodes by the sum of their edge supports, most first, ties in the
+    // order of for_each_node. The first num_supported have some
+    std::vector<node> order;
+    size_t num_supported = 0;
+};
+
+// Gets a node's edge supports, in the order of its adjacents
+const uint32_t *get_support(const edge_support &support, const node key_node) {
+    return support.counts.data() + support.offsets.at(key_node);
+}
+
+// Tests whether any of a node's edges is in a triangle
+bool has_support(const edge_support &support, const node key_node, const size_t degree) {
+    const uint32_t *counts = get_support(support, key_node);
+    return std::any_of(counts, counts + degree, [](uint32_t count) { return count > 0; });
+}
+
+// Counts the support of every edge with up to threads threads, 0 for the
+// OpenMP default
+template <typename G>
+edge_support compute_support(const G &adj_list, const int threads = 0) {
+    const int num_threads = threads > 0 ? threads : omp_get_max_threads();
+    edge_support support;
+    std::vector<node> ids;
+    ids.reserve(num_nodes(adj_list));
+    std::unordered_map<node, node> local_ids;
+    local_ids.reserve(num_nodes(adj_list));
+    support.offsets.reserve(num_nodes(adj_list));
+
+    // starts are the offsets by local id
+    std::vector<size_t> degrees;
+    std::vector<size_t> starts {0};
+    degrees.reserve(num_nodes(adj_list));
+    starts.reserve(num_nodes(adj_list) + 1);
+    for_each_node(adj_list, [&](const node key_node) {
+	local_ids.insert({key_node, ids.size()});
+	support.offsets.insert({key_node, starts.back()});
+	ids.push_back(key_node);
+	degrees.push_back(get_degree(adj_list, key_node));
+	starts.push_back(starts.back() + degrees.back());
+    });
+    const size_t total = starts.back();
+    const long num_ids = ids.size();
+    support.counts.assign(total, 0);
+    std::vector<uint64_t> node_counts(ids.size(), 0);
+
+    // the adjacents as local ids, so ids are only looked up once
+    std::vector<node> local_adjs(total);
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (long local = 0; local < num_ids; local++) {
+	size_t pos = starts.at(local);
+	for (node adj : get_adjs(adj_list, ids.at(local))) {
+	    local_adjs[pos++] = local_ids.at(adj);
+	}
+    }
+    std::unordered_map<node, node>().swap(local_ids);
+    auto ranks_below = [&](const node node_0, const node node_1) {
+	return degrees.at(node_0) < degrees.at(node_1) ||
+	    (degrees.at(node_0) == degrees.at(node_1) && node_0 < node_1);
+    };
+
+    // higher ranked adjacents, as sorted local ids, and the number of
+    // triangles on each of those edges
+    std::vector<std::vector<node>> higher(ids.size());
+    std::vector<std::vector<uint32_t>> oriented(ids.size());
+
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (long local = 0; local < num_ids; local++) {
+	std::vector<node> &these = higher.at(local);
+	for (size_t pos = starts.at(local); pos < starts.at(local + 1); pos++) {
+	    const node local_adj = local_adjs[pos];
+	    if (ranks_below(local, local_adj)) {
+		these.push_back(local_adj);
+	    }
+	}
+	// not every graph is deduplicated
+	std::sort(these.begin(), these.end());
+	these.erase(std::unique(these.begin(), these.end()), these.end());
+	oriented.at(local).assign(these.size(), 0);
+    }
+
+#pragma omp parallel for schedule(dynamic, 64) num_threads(num_threads)
+    for (long local = 0; local < num_ids; local++) {
+	const std::vector<node> &these = higher.at(local);
+	for (size_t idx = 0; idx < these.size(); idx++) {
+	    const node other = these.at(idx);
+	    const std::vector<node> &others = higher.at(other);
+	    size_t pos_0 = 0;
+	    size_t pos_1 = 0;
+
+	    while (pos_0 < these.size() && pos_1 < others.size()) {
+		if (these[pos_0] < others[pos_1]) {
+		    pos_0++;
+		} else if (others[pos_1] < these[pos_0]) {
+		    pos_1++;
+		} else {
+		    // local-other, local-third and other-third
+#pragma omp atomic
+		    oriented.at(local)[idx]++;
+#pragma omp atomic
+		    oriented.at(local)[pos_0]++;
+#pragma omp atomic
+		    oriented.at(other)[pos_1]++;
+		    pos_0++;
+		    pos_1++;
+		}
+	    }
+	}
+    }
+
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (long local = 0; local < num_ids; local++) {
+	uint64_t node_count = 0;
+	for (size_t pos = starts.at(local); pos < starts.at(local + 1); pos++) {
+	    const node local_adj = local_adjs[pos];
+	    uint32_t count = 0;
+	    if (local_adj != (node) local) {
+		const node low = ranks_below(local, local_adj) ? local : local_adj;
+		const node high = low == (node) local ? local_adj : local;
+		const std::vector<node> &lows = higher.at(low);
+		const size_t low_pos = std::lower_bound(lows.begin(), lows.end(), high) -
+		    lows.begin();
+		count = oriented.at(low).at(low_pos);
+	    }
+	    support.counts[pos] = count;
+	    node_count += count;
+	}
+	node_counts.at(local) = node_count;
+    }
+
+    std::vector<node> local_order(ids.size());
+    std::iota(local_order.begin(), local_order.end(), 0);
+    std::stable_sort(local_order.begin(), local_order.end(), [&](node node_0, node node_1) {
+	return node_counts.at(node_0) > node_counts.at(node_1);
+    });
+    support.order.reserve(ids.size());
+    for (node local : local_order) {
+	support.order.push_back(ids.at(local));
+	support.num_supported += node_counts.at(local) > 0;
+    }
+
+    return support;
+}
+
+// Adds the number of edges with each support to histogram, counting each
+// edge once
+template <typename G>
+void add_support_histogram(const G &adj_list, const edge_support &support,
+	std::vector<size_t> &histogram) {
+    histogram.resize(SUPPORT_HISTOGRAM_BUCKETS, 0);
+    for_each_node(adj_list, [&](const node key_node) {
+	const uint32_t *counts = get_support(support, key_node);
+	size_t idx = 0;
+	for (node adj : get_adjs(adj_list, key_node)) {
+	    if (key_node < adj) {
+		size_t bucket = 0;
+		for (uint32_t count = counts[idx]; count > 0; count >>= 1) {
+		    bucket++;
+		}
+		histogram.at(std::min(bucket, (size_t) SUPPORT_HISTOGRAM_BUCKETS - 1))++;
+	    }
+	    idx++;
+	}
+    });
+}
+
+// Formats a support histogram for the log, skipping empty buckets
+std::string format_support_histogram(const std::vector<size_t> &histogram) {
+    std::stringstream out;
+    for (size_t bucket = 0; bucket < histogram.size(); bucket++) {
+	if (histogram.at(bucket) == 0) {
+	    continue;
+	}
+	if (out.tellp() > 0) {
+	    out << " ";
+	}
+	if (bucket == 0) {
+	    out << "0";
+	} else if (bucket == 1) {
+	    out << "1";
+	} else if (bucket == histogram.size() - 1) {
+	    out << (1 << (bucket - 1)) << "+";
+	} else {
+	    out << (1 << (bucket - 1)) << "-" << (1 << bucket) - 1;
+	}
+	out << ": " << histogram.at(bucket);
+    }
+    return out.str();
+}
+
+#endif
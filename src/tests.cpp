@@ -1,6 +1,23 @@
 #include "algo.h"
+#include "blocks.h"
+#include "cache.h"
+#include "csr_graph.h"
+#include "peel.h"
+#include "portfolio.h"
+#include "repair.h"
+#include "stream.h"
+#include "tune.h"
 #include <gtest/gtest.h>
 
+// Adds the complete graph on the size nodes from first
+void add_clique(adjacency_list &g, const node first, const node size) {
+    for (node n = first; n < first + size; n++) {
+        for (node m = n + 1; m < first + size; m++) {
+            add_edge(g, n, m);
+        }
+    }
+}
+
 TEST(trim_whitespace_tests, trim_0) {
     std::string a = "  oh hello    ";
     std::string expected = "oh hello";
@@ -150,6 +167,19 @@ TEST(dedup_tests, dedup_0) {
     ASSERT_EQ(num_edges(g), 3);   
 }
 
+TEST(dedup_tests, dedup_self_loops_0) {
+    adjacency_list g;
+    add_edge(g, 4, 1);
+    add_edge(g, 4, 3);
+    add_edge(g, 4, 1);
+    g.at(4).push_back(4);
+    dedup(g);
+
+    std::vector<node> expected {1, 3};
+    ASSERT_EQ(g.at(4), expected);
+    ASSERT_EQ(num_edges(g), 2);
+}
+
 TEST(get_components_tests, get_comps_0) {
     adjacency_list g;
 
@@ -193,6 +223,791 @@ TEST(connect_comp_tests, connect_comp_0) {
     ASSERT_NE(two_search, g.at(2).end());
 }
 
+TEST(compressed_graph_tests, compress_0) {
+    adjacency_list g;
+    add_edge(g, 0, 1);
+    add_edge(g, 0, 2);
+    add_edge(g, 1, 2);
+    add_edge(g, 2, 300);
+    add_edge(g, 300, 100000);
+    add_edge(g, 0, 1);
+
+    compressed_graph c = compress(g);
+
+    ASSERT_EQ(num_nodes(c), 5);
+    ASSERT_EQ(get_degree(c, 0), 2);
+    ASSERT_EQ(get_degree(c, 300), 2);
+
+    std::vector<node> adjs(get_adjs(c, 2).begin(), get_adjs(c, 2).end());
+    std::vector<node> expected {0, 1, 300};
+    ASSERT_EQ(adjs, expected);
+
+    adjs.assign(get_adjs(c, 100000).begin(), get_adjs(c, 100000).end());
+    expected = {300};
+    ASSERT_EQ(adjs, expected);
+}
+
+TEST(compressed_graph_tests, compressed_algo_routine_0) {
+    adjacency_list g;
+    add_clique(g, 0, 8);
+
+    adjacency_list result = algo_routine(g, 1);
+    adjacency_list compressed_result = algo_routine(compress(g), 1);
+
+    ASSERT_EQ(num_edges(compressed_result), num_edges(result));
+    ASSERT_EQ(boyer_myrvold_test(compressed_result), true);
+}
+
+TEST(csr_graph_tests, csr_graph_0) {
+    // K6 and a triangle, stored the way a symmetric SciPy matrix is
+    adjacency_list g;
+    add_clique(g, 0, 6);
+    add_clique(g, 6, 3);
+    std::vector<int32_t> indptr {0};
+    std::vector<int32_t> indices;
+    for (node n = 0; n < 9; n++) {
+        std::vector<node> adjs = g.at(n);
+        std::sort(adjs.begin(), adjs.end());
+        indices.insert(indices.end(), adjs.begin(), adjs.end());
+        indptr.push_back(indices.size());
+    }
+    ASSERT_EQ(is_simple_csr(indptr.data(), indices.data(), 9, indices.size()), true);
+
+    csr_graph<int32_t> view;
+    view.indptr = indptr.data();
+    view.indices = indices.data();
+    view.num_rows = 9;
+    ASSERT_EQ(num_nodes(view), 9);
+    ASSERT_EQ(get_degree(view, 0), 5);
+    ASSERT_EQ(get_degree(view, 6), 2);
+
+    algo_options options;
+    options.dense_max_nodes = 0;
+    adjacency_list result = algo_routine(view, 2, options);
+    // both iterate nodes and adjacents in sorted order
+    adjacency_list expected = algo_routine(compress(g), 2, options);
+    dedup(result);
+    dedup(expected);
+    ASSERT_EQ(num_edges(result), num_edges(expected));
+    ASSERT_EQ(boyer_myrvold_test(result), true);
+
+    // one direction only, with a duplicate and a self loop
+    const edge_list edges {{0, 1}, {1, 2}, {1, 0}, {2, 2}};
+    csr_graph<int64_t> built = make_csr<int64_t>(3, edges.size(),
+            [&](const size_t idx) { return edges.at(idx); });
+    ASSERT_EQ(get_degree(built, 1), 2);
+    ASSERT_EQ(get_degree(built, 2), 1);
+    ASSERT_EQ(is_simple_csr(built.indptr, built.indices, 3, built.owned_indices->size()), true);
+    ASSERT_EQ(is_simple_csr(indptr.data(), indices.data(), 8, indptr.at(8)), false);
+
+    // partitions copied per thread are csr_graphs of their own
+    options.pin_threads = true;
+    result = algo_routine(view, 2, options);
+    dedup(result);
+    ASSERT_EQ(boyer_myrvold_test(result), true);
+}
+
+TEST(cache_tests, cache_key_0) {
+    uint64_t hash_0 = hash_line("a b", HASH_SEED);
+    uint64_t hash_1 = hash_line("a c", HASH_SEED);
+    ASSERT_NE(hash_0, hash_1);
+
+    ASSERT_EQ(cache_key(hash_0, "threads=1"), cache_key(hash_0, "threads=1"));
+    ASSERT_NE(cache_key(hash_0, "threads=1"), cache_key(hash_0, "threads=2"));
+    ASSERT_NE(cache_key(hash_0, "threads=1"), cache_key(hash_1, "threads=1"));
+    ASSERT_EQ(cache_key(hash_0, "threads=1").size(), 16);
+}
+
+TEST(update_routine_tests, update_0) {
+    adjacency_list g;
+    add_clique(g, 0, 6);
+    add_edge(g, 6, 7);
+    add_edge(g, 7, 8);
+    add_edge(g, 6, 8);
+    add_edge(g, 8, 9);
+
+    adjacency_list result = algo_routine(g, 1);
+    dedup(result);
+
+    edge_list inserted {std::make_pair(9, 10), std::make_pair(10, 11),
+        std::make_pair(9, 11)};
+    edge_list deleted {std::make_pair(6, 7)};
+    update_routine(g, result, inserted, deleted);
+    dedup(result);
+
+    ASSERT_EQ(boyer_myrvold_test(result), true);
+    ASSERT_EQ(get_components(result).size(), 2);
+
+    auto deleted_search = std::find(result.at(6).begin(), result.at(6).end(), 7);
+    ASSERT_EQ(deleted_search, result.at(6).end());
+
+    auto inserted_search = std::find(result.at(10).begin(), result.at(10).end(), 11);
+    ASSERT_NE(inserted_search, result.at(10).end());
+}
+
+TEST(edge_writer_tests, edge_writer_0) {
+    const std::string file_path = "edge_writer_test_output.txt";
+    std::unordered_map<node, std::string> labels {{0, "a"}, {1, "b"}, {2, "c"}};
+
+    {
+        edge_writer writer(file_path, labels);
+        writer.push(std::vector<node> {0, 1, 1, 2});
+        writer.push(edge_list {std::make_pair(1, 0), std::make_pair(2, 0)});
+        ASSERT_EQ(writer.finish(), true);
+        ASSERT_EQ(writer.edges_written(), 3);
+    }
+
+    load_result lr = load_edge_list(file_path);
+    std::remove(file_path.c_str());
+
+    ASSERT_EQ(std::get<0>(lr).size(), 3);
+    ASSERT_EQ(std::get<1>(lr).count("a"), 1);
+}
+
+TEST(streams_tests, compressed_round_trip_0) {
+    std::unordered_map<node, std::string> labels {{0, "a"}, {1, "b"}, {2, "c"}};
+    adjacency_list g;
+    add_edge(g, 0, 1);
+    add_edge(g, 1, 2);
+
+    for (std::string file_path : {"streams_test.txt.gz", "streams_test.txt.zst"}) {
+        write_graph(g, labels, file_path);
+        ASSERT_NE(detect_compression(file_path), NO_COMPRESSION);
+
+        load_result lr = load_edge_list(file_path);
+        std::remove(file_path.c_str());
+
+        ASSERT_EQ(std::get<0>(lr).size(), 2);
+        ASSERT_EQ(std::get<1>(lr).count("c"), 1);
+    }
+}
+
+TEST(scratch_arena_tests, reuse_0) {
+    scratch_arena arena;
+
+    void *first = arena.allocate(64, 8);
+    // doesn't fit in the rest of the first block
+    void *second = arena.allocate(ARENA_BLOCK_SIZE, 8);
+    ASSERT_NE(second, nullptr);
+    ASSERT_EQ(arena.num_blocks(), 2);
+
+    arena.reset();
+    ASSERT_EQ(arena.allocate(64, 8), first);
+    ASSERT_EQ(arena.allocate(ARENA_BLOCK_SIZE, 8), second);
+    ASSERT_EQ(arena.num_blocks(), 2);
+
+    void *aligned = arena.allocate(3, 64);
+    ASSERT_EQ(reinterpret_cast<size_t>(aligned) % 64, 0);
+}
+
+TEST(perf_counters_tests, counters_0) {
+    perf_counters counters = start_counters();
+    volatile size_t sum = 0;
+    for (size_t idx = 0; idx < 100000; idx++) {
+        sum += idx;
+    }
+    counter_values values = stop_counters(counters);
+
+    // counters may be unavailable, but must never read as garbage
+    for (int64_t value : values) {
+        ASSERT_GE(value, -1);
+    }
+
+    counter_values total = empty_counter_values();
+    add_counter_values(total, values);
+    add_counter_values(total, values);
+    if (values[INSTRUCTIONS] >= 0) {
+        ASSERT_EQ(total[INSTRUCTIONS], values[INSTRUCTIONS] * 2);
+    } else {
+        ASSERT_EQ(total[INSTRUCTIONS], -1);
+        ASSERT_NE(format_counters(total).find("n/a"), std::string::npos);
+    }
+}
+
+TEST(pipeline_tests, load_graph_0) {
+    const std::string file_path = "pipeline_test.txt";
+    {
+        std::ofstream file_out(file_path);
+        // more lines than one batch, with duplicates and self loops
+        for (size_t idx = 0; idx < 3 * PIPELINE_BATCH_SIZE; idx++) {
+            file_out << "n" << idx % 1000 << " n" << (idx * 7) % 1000 << "\n";
+        }
+    }
+
+    uint64_t expected_hash;
+    uint64_t hash;
+    load_result expected = load_edge_list(file_path, &expected_hash);
+    graph_load_result lr = load_graph(file_path, &hash);
+    std::remove(file_path.c_str());
+
+    ASSERT_EQ(hash, expected_hash);
+    ASSERT_EQ(std::get<1>(lr), std::get<1>(expected));
+    ASSERT_EQ(std::get<2>(lr), std::get<2>(expected));
+    ASSERT_EQ(std::get<0>(lr), to_adj_list(std::get<0>(expected)));
+}
+
+TEST(time_limit_tests, past_deadline_0) {
+    adjacency_list g;
+    add_clique(g, 0, 8);
+
+    size_t nodes_covered = 0;
+    algo_options options;
+    options.time_limit = std::chrono::steady_clock::now();
+    options.nodes_covered = &nodes_covered;
+    adjacency_list result = algo_routine(g, 1, options);
+
+    ASSERT_EQ(result.size(), g.size());
+    ASSERT_LT(nodes_covered, g.size());
+    ASSERT_EQ(boyer_myrvold_test(result), true);
+
+    nodes_covered = 0;
+    options.time_limit = NO_DEADLINE;
+    result = algo_routine(g, 1, options);
+    ASSERT_EQ(nodes_covered, g.size());
+}
+
+TEST(blocks_tests, find_blocks_0) {
+    // two triangles sharing node 2, with a pendant edge off node 4
+    adjacency_list g;
+    add_edge(g, 0, 1);
+    add_edge(g, 1, 2);
+    add_edge(g, 2, 0);
+    add_edge(g, 2, 3);
+    add_edge(g, 3, 4);
+    add_edge(g, 4, 2);
+    add_edge(g, 4, 5);
+
+    std::vector<edge_list> blocks = find_blocks(0, g);
+    std::vector<size_t> sizes;
+    for (const edge_list &block : blocks) {
+        sizes.push_back(block.size());
+    }
+    std::sort(sizes.begin(), sizes.end());
+
+    ASSERT_EQ(sizes, std::vector<size_t>({1, 3, 3}));
+}
+
+TEST(blocks_tests, block_routine_0) {
+    // two K5 blocks joined by a path, only the K5s need the algorithm
+    adjacency_list g;
+    add_clique(g, 0, 5);
+    add_clique(g, 10, 5);
+    add_edge(g, 4, 7);
+    add_edge(g, 7, 10);
+
+    adjacency_list result = block_routine(g, 2);
+    dedup(result);
+
+    ASSERT_EQ(result.size(), g.size());
+    ASSERT_EQ(boyer_myrvold_test(result), true);
+    ASSERT_EQ(get_components(result).size(), 1);
+    // the path is kept whole
+    ASSERT_EQ(get_degree(result, 7), 2);
+}
+
+TEST(blocks_tests, block_routine_1) {
+    // K5 with a path hanging off it, more threads than the K5 has nodes
+    adjacency_list g;
+    add_clique(g, 0, 5);
+    add_edge(g, 4, 5);
+    add_edge(g, 5, 6);
+    add_edge(g, 6, 7);
+
+    adjacency_list result = block_routine(g, 8);
+    dedup(result);
+
+    ASSERT_EQ(result.size(), g.size());
+    ASSERT_EQ(boyer_myrvold_test(result), true);
+    ASSERT_EQ(get_components(result).size(), 1);
+
+    // same without blocks, the partitions are capped at the node count
+    result = algo_routine(g, 16);
+    dedup(result);
+
+    ASSERT_EQ(result.size(), g.size());
+    ASSERT_EQ(boyer_myrvold_test(result), true);
+}
+
+TEST(peel_tests, peel_0) {
+    // K5 with a pendant tree on node 0 and a chain 1-5-6-2
+    adjacency_list g;
+    add_clique(g, 0, 5);
+    add_edge(g, 0, 7);
+    add_edge(g, 7, 8);
+    add_edge(g, 7, 9);
+    add_edge(g, 1, 5);
+    add_edge(g, 5, 6);
+    add_edge(g, 6, 2);
+    dedup(g);
+
+    peeled_graph peeled = peel_graph(g, 2);
+
+    ASSERT_EQ(peeled.core.size(), 5);
+    ASSERT_EQ(peeled.tree_edges.size(), 3);
+    ASSERT_EQ(peeled.chains.size(), 1);
+    ASSERT_EQ(peeled.peeled_nodes.size(), 5);
+
+    adjacency_list result = algo_routine(peeled.core, 1);
+    restore_peeled(peeled, result);
+    dedup(result);
+
+    ASSERT_EQ(result.size(), g.size());
+    ASSERT_EQ(boyer_myrvold_test(result), true);
+    ASSERT_EQ(get_degree(result, 7), 3);
+    ASSERT_GE(get_degree(result, 5), 1);
+    ASSERT_GE(get_degree(result, 6), 1);
+}
+
+TEST(numa_tests, cpu_list_0) {
+    ASSERT_EQ(parse_cpu_list("0-3,8,10-11\n"), std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+    ASSERT_EQ(parse_cpu_list(""), std::vector<int>());
+}
+
+TEST(numa_tests, pinned_algo_routine_0) {
+    // on single node machines pinning falls back to the allowed cpus
+    std::vector<int> cpus = get_allowed_cpus();
+    ASSERT_GE(cpus.size(), 1);
+    ASSERT_GE(current_numa_node(), 0);
+
+    adjacency_list g;
+    add_clique(g, 0, 8);
+
+    std::vector<int> thread_numa_nodes;
+    algo_options options;
+    options.pin_threads = true;
+    options.thread_numa_nodes = &thread_numa_nodes;
+    adjacency_list pinned_result = algo_routine(g, 2, options);
+    // threads are unpinned afterwards, this one included
+    ASSERT_EQ(get_allowed_cpus(), cpus);
+    adjacency_list result = algo_routine(g, 2);
+
+    ASSERT_EQ(thread_numa_nodes.size(), 2);
+    ASSERT_EQ(num_edges(pinned_result), num_edges(result));
+}
+
+TEST(portfolio_tests, portfolio_0) {
+    adjacency_list g;
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<node> distribution(0, 59);
+    for (size_t idx = 0; idx < 300; idx++) {
+        node node_0 = distribution(generator);
+        node node_1 = distribution(generator);
+        if (node_0 != node_1) {
+            add_edge(g, node_0, node_1);
+        }
+    }
+    dedup(g);
+
+    size_t winner;
+    std::vector<algo_options> configs = make_portfolio(6, algo_options());
+    adjacency_list result = portfolio_routine(g, configs, 2, &winner);
+    adjacency_list default_result = algo_routine(g, 1);
+    dedup(default_result);
+
+    ASSERT_LT(winner, configs.size());
+    ASSERT_EQ(boyer_myrvold_test(result), true);
+    ASSERT_GE(num_edges(result), num_edges(default_result));
+}
+
+TEST(portfolio_tests, portfolio_options_0) {
+    adjacency_list g;
+    add_clique(g, 0, 8);
+    add_clique(g, 8, 8);
+    add_edge(g, 7, 8);
+
+    std::vector<counter_values> thread_counters;
+    std::vector<int> thread_numa_nodes;
+    std::vector<size_t> support_histogram;
+    algo_options options;
+    options.pin_threads = true;
+    options.thread_counters = &thread_counters;
+    options.thread_numa_nodes = &thread_numa_nodes;
+    options.support_histogram = &support_histogram;
+
+    const std::vector<int> cpus = get_allowed_cpus();
+    std::vector<algo_options> configs = make_portfolio(4, options);
+    for (const algo_options &config : configs) {
+        ASSERT_EQ(config.pin_threads, true);
+        ASSERT_EQ(config.thread_counters, &thread_counters);
+    }
+    adjacency_list result = portfolio_routine(g, configs, 2);
+
+    ASSERT_EQ(boyer_myrvold_test(result), true);
+    ASSERT_EQ(thread_counters.size(), 2);
+    ASSERT_EQ(thread_numa_nodes.size(), 2);
+    ASSERT_EQ(support_histogram.empty(), false);
+    ASSERT_EQ(get_allowed_cpus(), cpus);
+}
+
+TEST(portfolio_tests, cannot_win_0) {
+    std::atomic<size_t> best_edges {100};
+    run_progress progress;
+    progress.num_nodes = 50;
+    progress.best_edges = &best_edges;
+    progress.edges = 10;
+    progress.covered = 20;
+    progress.components = 2;
+
+    // 10 + 2 * 30 + 2 * 2 = 74
+    ASSERT_EQ(progress.upper_bound(), 74);
+    ASSERT_EQ(progress.cannot_win(), true);
+}
+
+TEST(dense_graph_tests, dense_0) {
+    adjacency_list g;
+    add_edge(g, 10, 20);
+    add_edge(g, 10, 30);
+    add_edge(g, 20, 30);
+    add_edge(g, 30, 1000);
+
+    dense_graph d = make_dense(g);
+    ASSERT_EQ(num_nodes(d), 4);
+    ASSERT_EQ(d.words, 1);
+
+    for_each_node(d, [&](const node local_node) {
+        ASSERT_EQ(get_degree(d, local_node), get_degree(g, d.ids.at(local_node)));
+        for (node adj : get_adjs(d, local_node)) {
+            ASSERT_EQ(has_edge(d, local_node, adj), true);
+            ASSERT_EQ(has_edge(d, adj, local_node), true);
+        }
+        ASSERT_EQ(has_edge(d, local_node, local_node), false);
+    });
+    ASSERT_EQ(d.ids.at(get_max_degree_node(d)), get_max_degree_node(g));
+}
+
+TEST(dense_graph_tests, dense_algo_routine_0) {
+    // a triangulated grid, with a few long edges to make it non-planar
+    adjacency_list g;
+    for (node n = 0; n < 400; n++) {
+        if (n % 20 != 19) {
+            add_edge(g, n, n + 1);
+        }
+        if (n < 380) {
+            add_edge(g, n, n + 20);
+            if (n % 20 != 19) {
+                add_edge(g, n, n + 21);
+            }
+        }
+        if (n % 7 == 0) {
+            add_edge(g, n, (n * 13 + 101) % 400);
+        }
+    }
+    dedup(g);
+
+    algo_options sparse_options;
+    sparse_options.dense_max_nodes = 0;
+    size_t dense_covered = 0;
+    size_t sparse_covered = 0;
+    algo_options dense_options;
+    dense_options.nodes_covered = &dense_covered;
+    sparse_options.nodes_covered = &sparse_covered;
+
+    adjacency_list dense_result = algo_routine(g, 2, dense_options);
+    adjacency_list sparse_result = algo_routine(g, 2, sparse_options);
+    dedup(dense_result);
+    dedup(sparse_result);
+
+    ASSERT_EQ(boyer_myrvold_test(dense_result), true);
+    ASSERT_EQ(dense_covered, 400);
+    ASSERT_EQ(dense_covered, sparse_covered);
+    // restarts can pick different nodes, so the results may differ slightly
+    ASSERT_GE(num_edges(dense_result) * 20, num_edges(sparse_result) * 19);
+}
+
+TEST(hub_index_tests, hub_index_0) {
+    adjacency_list g;
+    for (node n = 1; n <= 5; n++) {
+        add_edge(g, 0, n);
+    }
+    add_edge(g, 1, 2);
+    add_edge(g, 2, 6);
+
+    hub_index index = make_hub_index(g, 5);
+    ASSERT_EQ(index.hubs.size(), 1);
+    ASSERT_NE(find_hub(index, 0), nullptr);
+    ASSERT_EQ(find_hub(index, 1), nullptr);
+
+    ASSERT_EQ(has_edge(index, 0, g.at(0), 3), true);
+    ASSERT_EQ(has_edge(index, 3, g.at(3), 0), true);
+    ASSERT_EQ(has_edge(index, 2, g.at(2), 6), true);
+    ASSERT_EQ(has_edge(index, 0, g.at(0), 6), false);
+    ASSERT_EQ(has_edge(index, 1, g.at(1), 6), false);
+
+    // common adjacents of the hub and 1 are looked for among 1's
+    ASSERT_EQ(swap_hub(index, 0, g.at(0), g.at(1)), find_hub(index, 0));
+    ASSERT_EQ(swap_hub(index, 1, g.at(1), g.at(0)), nullptr);
+}
+
+TEST(partition_view_tests, partition_view_0) {
+    adjacency_list g;
+    for (node n = 0; n < 300; n++) {
+        add_edge(g, n, (n + 1) % 300);
+        add_edge(g, n, (n * 11 + 5) % 300);
+    }
+    dedup(g);
+
+    const std::vector<partition_view<adjacency_list>> partitions = partition_nodes(g, 4);
+    ASSERT_EQ(partitions.size(), 4);
+
+    size_t total_nodes = 0;
+    for (const partition_view<adjacency_list> &partition : partitions) {
+        total_nodes += num_nodes(partition);
+        // the view's adjacents are the graph's within the same partition
+        const adjacency_list copy = materialize(partition);
+        ASSERT_EQ(copy.size(), num_nodes(partition));
+        for_each_node(partition, [&](const node key_node) {
+            ASSERT_EQ(get_partition(*partition.map, key_node), partition.id);
+            std::vector<node> expected;
+            for (node adj : g.at(key_node)) {
+                if (get_partition(*partition.map, adj) == partition.id) {
+                    expected.push_back(adj);
+                }
+            }
+            ASSERT_EQ(copy.at(key_node), expected);
+            ASSERT_EQ(get_degree(partition, key_node), expected.size());
+            ASSERT_EQ(get_adjs(partition, key_node).size(), expected.size());
+        });
+    }
+    ASSERT_EQ(total_nodes, 300);
+
+    // a single partition is the whole graph
+    const std::vector<partition_view<adjacency_list>> whole = partition_nodes(g, 1);
+    ASSERT_EQ(num_nodes(whole.at(0)), 300);
+    ASSERT_EQ(materialize(whole.at(0)), g);
+    ASSERT_EQ(whole.at(0).map->is_sparse, false);
+
+    // sparse ids are mapped through a hash map, into the same partitions
+    adjacency_list spread;
+    for (auto &[key_node, adjs] : g) {
+        add_node(spread, key_node * 1000000007, 0);
+        for (node adj : adjs) {
+            spread.at(key_node * 1000000007).push_back(adj * 1000000007);
+        }
+    }
+    const std::vector<partition_view<adjacency_list>> spread_partitions =
+        partition_nodes(spread, 4);
+    ASSERT_EQ(spread_partitions.at(0).map->is_sparse, true);
+    ASSERT_EQ(spread_partitions.at(0).map->ids.size(), 0);
+    total_nodes = 0;
+    for (const partition_view<adjacency_list> &partition : spread_partitions) {
+        total_nodes += num_nodes(partition);
+        for_each_node(partition, [&](const node key_node) {
+            size_t degree = 0;
+            for (node adj : get_adjs(partition, key_node)) {
+                ASSERT_EQ(get_partition(*partition.map, adj), partition.id);
+                degree++;
+            }
+            ASSERT_EQ(get_degree(partition, key_node), degree);
+        });
+    }
+    ASSERT_EQ(total_nodes, 300);
+    // boyer_myrvold_test indexes by node id, so the result is mapped back
+    adjacency_list result;
+    for (auto &[key_node, adjs] : algo_routine(spread, 4)) {
+        add_node(result, key_node / 1000000007, 0);
+        for (node adj : adjs) {
+            result.at(key_node / 1000000007).push_back(adj / 1000000007);
+        }
+    }
+    dedup(result);
+    ASSERT_EQ(result.size(), 300);
+    ASSERT_EQ(boyer_myrvold_test(result), true);
+}
+
+TEST(support_tests, support_0) {
+    // K4 with a pendant path and a 4-cycle, which have no triangles
+    adjacency_list g;
+    add_clique(g, 0, 4);
+    add_edge(g, 3, 4);
+    add_edge(g, 4, 5);
+    add_edge(g, 5, 6);
+    add_edge(g, 6, 7);
+    add_edge(g, 7, 4);
+
+    const edge_support support = compute_support(g);
+    for (auto &[key_node, adjs] : g) {
+        const uint32_t *counts = get_support(support, key_node);
+        for (size_t idx = 0; idx < adjs.size(); idx++) {
+            ASSERT_EQ(counts[idx], key_node < 4 && adjs.at(idx) < 4 ? 2 : 0);
+        }
+    }
+    ASSERT_EQ(support.num_supported, 4);
+    ASSERT_EQ(compute_support(g, 1).counts, support.counts);
+    ASSERT_LT(support.order.at(0), 4);
+    ASSERT_EQ(has_support(support, 3, g.at(3).size()), true);
+    ASSERT_EQ(has_support(support, 5, g.at(5).size()), false);
+
+    std::vector<size_t> histogram;
+    add_support_histogram(g, support, histogram);
+    ASSERT_EQ(histogram.at(0), 5);
+    ASSERT_EQ(histogram.at(2), 6);
+    ASSERT_EQ(format_support_histogram(histogram), "0: 5 2-3: 6");
+
+    // nodes in no triangle are still covered, each on its own, by both the
+    // sparse and the dense search
+    for (size_t dense_max_nodes : {(size_t) 0, (size_t) DENSE_GRAPH_MAX_NODES}) {
+        algo_options options;
+        options.dense_max_nodes = dense_max_nodes;
+        size_t covered = 0;
+        options.nodes_covered = &covered;
+        std::vector<size_t> partition_histogram;
+        options.support_histogram = &partition_histogram;
+        adjacency_list result = algo_routine(g, 1, options);
+        dedup(result);
+        ASSERT_EQ(covered, 8);
+        ASSERT_EQ(boyer_myrvold_test(result), true);
+        ASSERT_EQ(partition_histogram, histogram);
+    }
+}
+
+TEST(trace_tests, trace_0) {
+    const std::string file_path = "trace_test_output.json";
+    adjacency_list g;
+    for (node n = 0; n < 200; n++) {
+        add_edge(g, n, (n + 1) % 200);
+        add_edge(g, n, (n + 2) % 200);
+        add_edge(g, n, (n * 7 + 3) % 200);
+    }
+    dedup(g);
+
+    start_tracing();
+    algo_routine(g, 2);
+    ASSERT_EQ(write_trace(file_path), true);
+
+    std::ifstream file_in(file_path);
+    std::stringstream contents;
+    contents << file_in.rdbuf();
+    std::remove(file_path.c_str());
+
+    for (const char *name : {"partition build", "propagate", "merge wait", "barrier wait",
+            "connect components"}) {
+        ASSERT_NE(contents.str().find(std::string("\"name\": \"") + name + "\""),
+                std::string::npos);
+    }
+    ASSERT_EQ(contents.str().back(), '\n');
+}
+
+TEST(stream_tests, stream_0) {
+    const std::string file_path = "stream_test_input.txt";
+    {
+        // K5 and a 4-cycle joined by an edge, with a duplicate and a self loop
+        std::ofstream file_out(file_path);
+        for (int n = 0; n < 5; n++) {
+            for (int m = n + 1; m < 5; m++) {
+                file_out << "k" << n << "\tk" << m << "\n";
+            }
+        }
+        file_out << "c0 c1\nc1 c2\n  c2   c3\nc3 c0\nk0 c0\nk1 k0\nc1 c1\nlonely\n";
+    }
+
+    std::ostringstream out;
+    stream_stats stats;
+    adjacency_list result = stream_routine(file_path, out, STREAM_RESERVOIR_SIZE, stats);
+    std::remove(file_path.c_str());
+
+    ASSERT_EQ(stats.edges_read, 17);
+    ASSERT_EQ(boyer_myrvold_test(result), true);
+    ASSERT_EQ(num_edges(result), stats.accepted);
+    // the 4-cycle can only be closed from the reservoir
+    ASSERT_GE(stats.reservoir_accepted, 1);
+
+    std::stringstream lines(out.str());
+    std::string line;
+    size_t num_lines = 0;
+    while (getline(lines, line)) {
+        ASSERT_EQ(parse_line(line).size(), 2);
+        num_lines++;
+    }
+    ASSERT_EQ(num_lines, stats.accepted);
+}
+
+TEST(tune_tests, choose_threads_0) {
+    graph_stats stats;
+    stats.num_edges = 1000000;
+    stats.max_degree = 100;
+
+    // enough work and edges for every cpu
+    auto_choice choice = choose_threads(stats, 1e-6, 8);
+    ASSERT_EQ(choice.threads, 8);
+    ASSERT_EQ(choice.partitions, 8);
+    ASSERT_EQ(choice.limit, "cpus");
+
+    // 1 second of work makes 20 partitions worth it, 1M edges 20 as well
+    choice = choose_threads(stats, 1e-6, 64);
+    ASSERT_EQ(choice.partitions, 20);
+
+    // a hub with a third of the edges
+    stats.max_degree = 333334;
+    choice = choose_threads(stats, 1e-6, 64);
+    ASSERT_EQ(choice.partitions, 2);
+    ASSERT_EQ(choice.limit, "max degree");
+
+    // too little work for more than one thread
+    stats.max_degree = 100;
+    choice = choose_threads(stats, 1e-9, 64);
+    ASSERT_EQ(choice.threads, 1);
+    ASSERT_EQ(choice.limit, "work");
+}
+
+TEST(tune_tests, calibration_0) {
+    const std::string file_path = "calibration_test.txt";
+    adjacency_list g;
+    for (node n = 0; n < 500; n++) {
+        add_edge(g, n, (n + 1) % 500);
+        add_edge(g, n, (n + 2) % 500);
+        add_edge(g, n, (n * 7 + 3) % 500);
+    }
+    dedup(g);
+
+    const graph_stats stats = sample_graph_stats(g);
+    ASSERT_EQ(stats.num_nodes, 500);
+    ASSERT_EQ(stats.num_edges, num_edges(g));
+    ASSERT_GT(stats.degree_cv, 0);
+
+    const double edge_cost = calibrate_edge_cost(g);
+    ASSERT_GT(edge_cost, 0);
+
+    double loaded = 0;
+    std::remove(file_path.c_str());
+    ASSERT_EQ(load_calibration(file_path, loaded), false);
+    ASSERT_EQ(store_calibration(file_path, edge_cost), true);
+    ASSERT_EQ(load_calibration(file_path, loaded), true);
+    std::remove(file_path.c_str());
+    ASSERT_NEAR(loaded, edge_cost, edge_cost * 1e-4);
+}
+
+TEST(repair_tests, repair_0) {
+    // K5 and K3,3 joined by an edge, plus a square
+    adjacency_list g;
+    add_clique(g, 0, 5);
+    for (node n = 5; n < 8; n++) {
+        for (node m = 8; m < 11; m++) {
+            add_edge(g, n, m);
+        }
+    }
+    add_edge(g, 4, 5);
+    add_edge(g, 11, 12);
+    add_edge(g, 12, 13);
+    add_edge(g, 13, 14);
+    add_edge(g, 14, 11);
+    add_edge(g, 10, 11);
+    ASSERT_EQ(find_kuratowski_edges(g).empty(), false);
+
+    // the K5 can lose one of its added edges, the K3,3 has none
+    const edge_list added {{1, 3}, {4, 5}, {12, 13}};
+    const repair_stats stats = repair_planarity(g, added);
+
+    ASSERT_EQ(boyer_myrvold_test(g), true);
+    ASSERT_EQ(find_kuratowski_edges(g).empty(), true);
+    ASSERT_EQ(stats.nonplanar_blocks, 2);
+    ASSERT_EQ(stats.removed_added, 1);
+    ASSERT_EQ(stats.removed_other, 1);
+    ASSERT_EQ(std::count(stats.removed.begin(), stats.removed.end(),
+                std::make_pair((node) 1, (node) 3)), 1);
+    // edges outside the non-planar blocks are kept
+    ASSERT_EQ(num_edges(g), 10 + 9 + 1 + 4 + 1 - 2);
+}
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,167 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Timeline tracing in the Chrome trace event format, for chrome://tracing
+// or Perfetto. Each thread records spans into its own fixed size ring
+// buffer, so recording takes no locks and doesn't allocate. When a ring is
+// full the oldest spans are overwritten. Recording is off until
+// start_tracing is called, then a span costs two clock reads
+
+// Spans kept per thread
+#define TRACE_RING_SIZE 65536
+// Threads that can record, spans from any more are dropped
+#define TRACE_MAX_THREADS 256
+
+// A finished span. name must be a string literal, arg is shown in the
+// trace as the span's id, e.g. a partition index, if not NO_TRACE_ARG
+struct trace_event {
+    const char *name;
+    uint64_t start_us;
+    uint64_t duration_us;
+    int64_t arg;
+};
+
+const int64_t NO_TRACE_ARG = -1;
+
+// Events of one thread. Only the owning thread writes, the count is
+// published with release so the writer of the trace file sees the events
+struct trace_ring {
+    std::array<trace_event, TRACE_RING_SIZE> events;
+    std::atomic<uint64_t> count {0};
+};
+
+struct trace_state {
+    std::atomic<bool> enabled {false};
+    std::chrono::steady_clock::time_point start;
+    std::array<std::atomic<trace_ring *>, TRACE_MAX_THREADS> rings {};
+    std::atomic<size_t> num_threads {0};
+};
+
+trace_state &get_trace_state() {
+    static trace_state state;
+    return state;
+}
+
+bool tracing() {
+    return get_trace_state().enabled.load(std::memory_order_acquire);
+}
+
+// Microseconds since tracing started
+uint64_t trace_now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+	    std::chrono::steady_clock::now() - get_trace_state().start).count();
+}
+
+// The start time of a span, without reading the clock when not tracing
+uint64_t trace_start() {
+    return tracing() ? trace_now() : 0;
+}
+
+// Gets the calling thread's ring, registering it on first use. Returns
+// nullptr once TRACE_MAX_THREADS threads have registered
+trace_ring *get_trace_ring() {
+    thread_local trace_ring *ring = nullptr;
+    thread_local bool registered = false;
+
+    if (!registered) {
+	registered = true;
+	trace_state &state = get_trace_state();
+	const size_t slot = state.num_threads++;
+	if (slot < TRACE_MAX_THREADS) {
+	    // rings live until exit, the trace is written after threads end
+	    ring = new trace_ring();
+	    state.rings.at(slot).store(ring, std::memory_order_release);
+	}
+    }
+    return ring;
+}
+
+// Starts recording. The calling thread becomes the first track
+void start_tracing() {
+    trace_state &state = get_trace_state();
+    state.start = std::chrono::steady_clock::now();
+    state.enabled = true;
+    get_trace_ring();
+}
+
+// Records a span that started at start_us and ends now
+void trace_complete(const char *name, const uint64_t start_us, const int64_t arg = NO_TRACE_ARG) {
+    if (!tracing()) {
+	return;
+    }
+    trace_ring *ring = get_trace_ring();
+    if (ring == nullptr) {
+	return;
+    }
+
+    const uint64_t count = ring->count.load(std::memory_order_relaxed);
+    ring->events[count % TRACE_RING_SIZE] = {name, start_us, trace_now() - start_us, arg};
+    ring->count.store(count + 1, std::memory_order_release);
+}
+
+// Records a span for the lifetime of the object
+struct trace_scope {
+    const char *name;
+    int64_t arg;
+    uint64_t start_us;
+
+    trace_scope(const char *name, const int64_t arg = NO_TRACE_ARG) :
+	name(name), arg(arg), start_us(trace_start()) {}
+
+    ~trace_scope() {
+	trace_complete(name, start_us, arg);
+    }
+};
+
+// Writes the recorded spans as a trace event JSON file, one track per
+// thread. Called once the traced threads are done. Returns false if the
+// file couldn't be written
+bool write_trace(const std::string &path) {
+    trace_state &state = get_trace_state();
+    std::ofstream file_out(path);
+    if (!file_out) {
+	return false;
+    }
+
+    file_out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    file_out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, "
+	<< "\"args\": {\"name\": \"planarityfilter\"}}";
+
+    const size_t num_threads = std::min((size_t) TRACE_MAX_THREADS, state.num_threads.load());
+    for (size_t tid = 0; tid < num_threads; tid++) {
+	const trace_ring *ring = state.rings.at(tid).load(std::memory_order_acquire);
+	if (ring == nullptr) {
+	    continue;
+	}
+
+	file_out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << tid
+	    << ", \"args\": {\"name\": \"" << (tid == 0 ? "main" : "thread " + std::to_string(tid))
+	    << "\"}}";
+
+	const uint64_t count = ring->count.load(std::memory_order_acquire);
+	const uint64_t first = count > TRACE_RING_SIZE ? count - TRACE_RING_SIZE : 0;
+	for (uint64_t idx = first; idx < count; idx++) {
+	    const trace_event &event = ring->events[idx % TRACE_RING_SIZE];
+	    file_out << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, "
+		<< "\"tid\": " << tid << ", \"ts\": " << event.start_us
+		<< ", \"dur\": " << event.duration_us;
+	    if (event.arg != NO_TRACE_ARG) {
+		file_out << ", \"args\": {\"id\": " << event.arg << "}";
+	    }
+	    file_out << "}";
+	}
+    }
+
+    file_out << "\n]}\n";
+    return (bool) file_out;
+}
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef TUNE_H
+#define TUNE_H
+
+#include "algo.h"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+// Automatic thread and partition counts. Each partition loses the edges cut
+// between it and the others, apart from the bridges added afterwards, so
+// partitions should only be added while they still save meaningful time.
+// The count is the smallest of:
+//
+// - the cpus available
+// - one partition per AUTO_MIN_PARTITION_EDGES edges, beyond which the
+//   graph gets too fragmented
+// - one per max degree edges, as a partition can't get much cheaper than
+//   the largest hub's neighbourhood, so more of them don't shorten the run
+// - one per AUTO_MIN_PARTITION_SECONDS of predicted single thread work,
+//   from a per edge cost measured on a sample of the graph
+//
+// The measured cost can be stored in a calibration file and reused, which
+// skips the measurement on later runs
+
+#define AUTO_MIN_PARTITION_EDGES 50000
+#define AUTO_MIN_PARTITION_SECONDS 0.05
+// Nodes whose degrees are sampled for the degree statistics
+#define AUTO_SAMPLE_NODES 10000
+// Size of the sample the per edge cost is measured on
+#define AUTO_CALIBRATION_EDGES 100000
+
+struct graph_stats {
+    size_t num_nodes = 0;
+    size_t num_edges = 0;
+    size_t max_degree = 0;
+    double mean_degree = 0;
+    // coefficient of variation of the sampled degrees, high for power law
+    // graphs
+    double degree_cv = 0;
+};
+
+struct auto_choice {
+    int threads = 1;
+    size_t partitions = 1;
+    // predicted single thread propagation time
+    double serial_seconds = 0;
+    // which limit decided the count
+    std::string limit;
+};
+
+// Gets n, m and the max degree exactly, and the degree spread from a sample
+// of nodes
+template <typename G>
+graph_stats sample_graph_stats(const G &adj_list, const uint32_t seed = 42) {
+    graph_stats stats;
+    stats.num_nodes = num_nodes(adj_list);
+    if (stats.num_nodes == 0) {
+	return stats;
+    }
+
+    size_t degree_sum = 0;
+    for_each_node(adj_list, [&](const node key_node) {
+	const size_t degree = get_degree(adj_list, key_node);
+	degree_sum += degree;
+	stats.max_degree = std::max(stats.max_degree, degree);
+    });
+    stats.num_edges = degree_sum / 2;
+    stats.mean_degree = (double) degree_sum / stats.num_nodes;
+
+    // every node is kept with the same probability, so the sample is uniform
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> distribution(0, 1);
+    const double keep = std::min(1.0, (double) AUTO_SAMPLE_NODES / stats.num_nodes);
+    double sum = 0;
+    double sum_squares = 0;
+    size_t num_sampled = 0;
+
+    for_each_node(adj_list, [&](const node key_node) {
+	if (distribution(generator) < keep) {
+	    const double degree = get_degree(adj_list, key_node);
+	    sum += degree;
+	    sum_squares += degree * degree;
+	    num_sampled++;
+	}
+    });
+
+    if (num_sampled > 0 && sum > 0) {
+	const double mean = sum / num_sampled;
+	const double variance = std::max(0.0, sum_squares / num_sampled - mean * mean);
+	stats.degree_cv = std::sqrt(variance) / mean;
+    }
+
+    return stats;
+}
+
+// Measures the single thread propagation cost in seconds per edge, on the
+// subgraph induced by a BFS of about AUTO_CALIBRATION_EDGES edges from the
+// max degree node, so hubs are part of the sample
+template <typename G>
+double calibrate_edge_cost(const G &adj_list) {
+    if (num_nodes(adj_list) == 0) {
+	return 0;
+    }
+
+    std::unordered_set<node> sample;
+    std::deque<node> queue {get_max_degree_node(adj_list)};
+    size_t sample_degrees = 0;
+
+    while (!queue.empty() && sample_degrees < 2 * AUTO_CALIBRATION_EDGES) {
+	const node current_node = queue.front();
+	queue.pop_front();
+	if (!sample.insert(current_node).second) {
+	    continue;
+	}
+	sample_degrees += get_degree(adj_list, current_node);
+	for (node adj : get_adjs(adj_list, current_node)) {
+	    if (sample.find(adj) == sample.end()) {
+		queue.push_back(adj);
+	    }
+	}
+    }
+
+    adjacency_list sample_graph;
+    for (node this_node : sample) {
+	add_node(sample_graph, this_node, 0);
+	for (node adj : get_adjs(adj_list, this_node)) {
+	    if (sample.find(adj) != sample.end()) {
+		sample_graph.at(this_node).push_back(adj);
+	    }
+	}
+    }
+
+    const size_t sample_edges = num_edges(sample_graph);
+    if (sample_edges == 0) {
+	return 0;
+    }
+
+    // partitions that matter for tuning are too big for the dense path, and
+    // each of them counts support on its own thread
+    algo_options options;
+    options.dense_max_nodes = 0;
+    options.support_threads = 1;
+    const auto start = std::chrono::steady_clock::now();
+    propagate_graph(sample_graph, options, options.seed);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / sample_edges;
+}
+
+// Reads the per edge cost from a calibration file. Returns false if there
+// is no usable calibration
+bool load_calibration(const std::string &file_path, double &edge_cost) {
+    std::ifstream file_in(file_path);
+    std::string key;
+    double value;
+
+    while (file_in >> key >> value) {
+	if (key == "edge_cost" && value > 0) {
+	    edge_cost = value;
+	    return true;
+	}
+    }
+    return false;
+}
+
+bool store_calibration(const std::string &file_path, const double edge_cost) {
+    std::ofstream file_out(file_path);
+    file_out << "edge_cost " << std::setprecision(6) << edge_cost << "\n";
+    return (bool) file_out;
+}
+
+// Picks the thread and partition counts for a graph, with at most
+// max_threads threads
+auto_choice choose_threads(const graph_stats &stats, const double edge_cost,
+	const int max_threads) {
+    auto_choice choice;
+    choice.serial_seconds = edge_cost * stats.num_edges;
+
+    const std::pair<size_t, const char *> limits[] = {
+	{(size_t) std::max(1, max_threads), "cpus"},
+	{stats.num_edges / AUTO_MIN_PARTITION_EDGES, "fragmentation"},
+	{stats.max_degree > 0 ? stats.num_edges / stats.max_degree : 1, "max degree"},
+	{(size_t) (choice.serial_seconds / AUTO_MIN_PARTITION_SECONDS), "work"},
+    };
+
+    choice.partitions = limits[0].first;
+    choice.limit = limits[0].second;
+    for (auto &[limit, name] : limits) {
+	if (limit < choice.partitions) {
+	    choice.partitions = limit;
+	    choice.limit = name;
+	}
+    }
+    choice.partitions = std::max((size_t) 1, choice.partitions);
+    choice.threads = (int) choice.partitions;
+
+    return choice;
+}
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef UTILS_H
+#define UTILS_H
+
 #include <unordered_map>
 #include <vector>
 #include <string>
@@ -6,7 +9,11 @@
 #include <tuple>
 #include <algorithm>
 #include <unordered_set>
+#include <random>
 #include <regex>
+#include <cstdint>
+
+#include "streams.h"
 
 #include "boost/graph/adjacency_list.hpp"
 #include "boost/graph/boyer_myrvold_planar_test.hpp"
@@ -65,21 +72,38 @@ std::vector<std::string> parse_line(std::string line) {
     return vec_out;
 }
 
+// Updates a 64-bit FNV-1a hash with the bytes of a line, used to
+// fingerprint input files while they are being read
+uint64_t hash_line(const std::string &line, uint64_t hash) {
+    for (unsigned char c : line) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    // account for the line break so that re-wrapped files differ
+    hash ^= '\n';
+    hash *= 1099511628211ULL;
+
+    return hash;
+}
+
+#define HASH_SEED 14695981039346656037ULL
+
 // Loads an edge list from file to a representation where each 
-// node is an int. Records the original node names in maps
-load_result load_edge_list(const std::string file_path) {
+// node is an int. Records the original node names in maps. If content_hash
+// is given, it is set to a hash of the file contents
+load_result load_edge_list(const std::string file_path, uint64_t *content_hash = nullptr) {
     edge_list edge_list_out;
     std::unordered_map<std::string, node> node_ids;
     std::unordered_map<node, std::string> node_ids_rev;
 
-    std::fstream file_in;
-
-    file_in.open(file_path, std::ios::in);
+    std::unique_ptr<std::istream> file_in = open_input(file_path);
 
     std::string line;
 
     size_t current_node_id = 0;
-    while (getline(file_in, line)) {
+    uint64_t hash = HASH_SEED;
+    while (getline(*file_in, line)) {
+        hash = hash_line(line, hash);
         std::vector <std::string> elements = parse_line(line);
 
         if (elements.size() > 1) {
@@ -102,7 +126,9 @@ load_result load_edge_list(const std::string file_path) {
         }
     }
 
-    file_in.close();
+    if (content_hash != nullptr) {
+        *content_hash = hash;
+    }
 
     return std::make_tuple(edge_list_out, node_ids, node_ids_rev);
 }
@@ -111,13 +137,11 @@ adjacency_list load_adj_list(const std::string file_path, const size_t num_nodes
     adjacency_list adj_list;
     adj_list.reserve(num_nodes);
 
-    std::fstream file_in;
-
-    file_in.open(file_path, std::ios::in);
+    std::unique_ptr<std::istream> file_in = open_input(file_path);
 
     std::string line;
 
-    while (getline(file_in, line)) {
+    while (getline(*file_in, line)) {
 	std::vector <std::string> elements = parse_line(line);
 
 	if (elements.size() > 1) {
@@ -144,8 +168,6 @@ adjacency_list load_adj_list(const std::string file_path, const size_t num_nodes
 	}
     }
 
-    file_in.close();
-
     return adj_list;
 }
 
@@ -178,20 +200,132 @@ void add_edge(adjacency_list &adj_list, const node node_0, const node node_1) {
     adj_list.at(node_1).push_back(node_0);
 }
 
-// Removes duplicate edges from an adjacency list
+// Removes an edge from the adjacency list, if it is there
+void remove_edge(adjacency_list &adj_list, const node node_0, const node node_1) {
+    auto search = adj_list.find(node_0);
+    if (search != adj_list.end()) {
+        std::vector<node> &adjs = search->second;
+        adjs.erase(std::remove(adjs.begin(), adjs.end(), node_1), adjs.end());
+    }
+
+    search = adj_list.find(node_1);
+    if (search != adj_list.end()) {
+        std::vector<node> &adjs = search->second;
+        adjs.erase(std::remove(adjs.begin(), adjs.end(), node_0), adjs.end());
+    }
+}
+
+// Gets the id for a node label, giving it the next free id if the label
+// has not been seen before
+node intern_label(const std::string &label, std::unordered_map<std::string, node> &node_ids,
+        std::unordered_map<node, std::string> &node_ids_rev) {
+    auto search = node_ids.find(label);
+    if (search != node_ids.end()) {
+        return search->second;
+    }
+
+    const node new_id = node_ids.size();
+    node_ids[label] = new_id;
+    node_ids_rev[new_id] = label;
+    return new_id;
+}
+
+// Loads an edge list whose node labels should map onto the ids of an
+// already loaded graph, such as a previous result. Unseen labels get new ids
+edge_list load_labeled_edges(const std::string file_path, 
+        std::unordered_map<std::string, node> &node_ids,
+        std::unordered_map<node, std::string> &node_ids_rev) {
+    edge_list edges;
+    std::unique_ptr<std::istream> file_in = open_input(file_path);
+
+    std::string line;
+    while (getline(*file_in, line)) {
+        std::vector<std::string> elements = parse_line(line);
+
+        if (elements.size() > 1) {
+            edges.push_back(std::make_pair(intern_label(elements.at(0), node_ids, node_ids_rev),
+                                           intern_label(elements.at(1), node_ids, node_ids_rev)));
+        }
+    }
+
+    return edges;
+}
+
+// Loads a delta file, where each line is an edge prefixed by + for an
+// insertion or - for a deletion, e.g. "+ a b"
+void load_delta(const std::string file_path, 
+        std::unordered_map<std::string, node> &node_ids,
+        std::unordered_map<node, std::string> &node_ids_rev,
+        edge_list &inserted, edge_list &deleted) {
+    std::unique_ptr<std::istream> file_in = open_input(file_path);
+
+    std::string line;
+    while (getline(*file_in, line)) {
+        std::vector<std::string> elements = parse_line(line);
+
+        if (elements.size() > 2 && (elements.at(0) == "+" || elements.at(0) == "-")) {
+            std::pair<node, node> edge = std::make_pair(
+                    intern_label(elements.at(1), node_ids, node_ids_rev),
+                    intern_label(elements.at(2), node_ids, node_ids_rev));
+
+            if (elements.at(0) == "+") {
+                inserted.push_back(edge);
+            } else {
+                deleted.push_back(edge);
+            }
+        }
+    }
+}
+
+// Gets the adjacents of a node. The algorithm accesses graphs through
+// get_adjs, get_degree, num_nodes and for_each_node so that other
+// representations (see compressed_graph.h) can be used in place of
+// adjacency_list
+const std::vector<node> &get_adjs(const adjacency_list &adj_list, const node key_node) {
+    return adj_list.at(key_node);
+}
+
+size_t get_degree(const adjacency_list &adj_list, const node key_node) {
+    return adj_list.at(key_node).size();
+}
+
+size_t num_nodes(const adjacency_list &adj_list) {
+    return adj_list.size();
+}
+
+template <typename F>
+void for_each_node(const adjacency_list &adj_list, F func) {
+    for (auto &[key_node, _adjs] : adj_list) {
+        func(key_node);
+    }
+}
+
+// Removes duplicate edges and self loops from an adjacency list, leaving
+// every node's adjacents sorted
 //
-// this could also just be accomplished by using unordered_sets instead of
-// vecs for adjacents
+// Lists are sorted in parallel. They are scheduled largest first so that a
+// few high degree nodes don't end up at the tail of one thread's work
 void dedup(adjacency_list &adj_list) {
-    for (auto element : adj_list) {
-	std::vector<node> *adjs = &adj_list.at(element.first);
-	std::sort((*adjs).begin(), (*adjs).end());
+    std::vector<std::pair<node, std::vector<node> *>> lists;
+    lists.reserve(adj_list.size());
+
+    for (auto &[key_node, adjs] : adj_list) {
+	lists.push_back(std::make_pair(key_node, &adjs));
     }
 
-    for (auto element : adj_list) {
-	std::vector<node> *adjs = &adj_list.at(element.first);
-	auto last = std::unique((*adjs).begin(), (*adjs).end());
-	(*adjs).erase(last, (*adjs).end());
+    std::sort(lists.begin(), lists.end(), [](const auto &a, const auto &b) {
+	return a.second->size() > b.second->size();
+    });
+
+#pragma omp parallel for schedule(dynamic, 64)
+    for (size_t idx = 0; idx < lists.size(); idx++) {
+	const node key_node = lists[idx].first;
+	std::vector<node> &adjs = *lists[idx].second;
+
+	std::sort(adjs.begin(), adjs.end());
+	auto last = std::unique(adjs.begin(), adjs.end());
+	last = std::remove(adjs.begin(), last, key_node);
+	adjs.erase(last, adjs.end());
     }
 }
 
@@ -270,17 +404,22 @@ bool boyer_myrvold_test(const adjacency_list &adj_list) {
 }
 
 // Returns the first node of maximum degree found
-node get_max_degree_node(const adjacency_list &adj_list) {
+template <typename G>
+node get_max_degree_node(const G &adj_list) {
     size_t max_deg = 0;
-    // TODO this is bad should probably be properly initialized w/ a value
-    node max_deg_node;
-
-    for (auto &[key_node, adjs] : adj_list) {
-        if (adjs.size() > max_deg) {
-            max_deg = adjs.size();
+    node max_deg_node = 0;
+    bool first = true;
+
+    // the first node is taken even at degree 0, so that partitions with
+    // only isolated nodes still start from one of their own nodes
+    for_each_node(adj_list, [&](const node key_node) {
+        const size_t degree = get_degree(adj_list, key_node);
+        if (first || degree > max_deg) {
+            first = false;
+            max_deg = degree;
             max_deg_node = key_node;
         }
-    }
+    });
     return max_deg_node;
 }
 
@@ -302,6 +441,23 @@ node get_max_degree_node(const std::unordered_set<node> &node_set, const adjacen
     return max_deg_node;
 }
 
+// Returns a node picked uniformly at random with the given seed
+template <typename G>
+node get_random_node(const G &adj_list, const uint32_t seed) {
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<size_t> distribution(0, num_nodes(adj_list) - 1);
+    size_t remaining = distribution(generator);
+    node random_node = 0;
+
+    for_each_node(adj_list, [&](const node key_node) {
+        if (remaining == 0) {
+            random_node = key_node;
+        }
+        remaining--;
+    });
+    return random_node;
+}
+
 // NOTE this is unused, but leaving for now
 // Use BFS to get all nodes dist hops or more away
 // maybe this should be in algo.h
@@ -357,6 +513,46 @@ void intersection(std::unordered_set<node> &set_a, const std::unordered_set<node
     }
 }
 
+// Disjoint sets over the indices 0..n-1 with path halving and union by size
+struct disjoint_sets {
+    std::vector<size_t> parent;
+    std::vector<size_t> size;
+};
+
+disjoint_sets make_disjoint_sets(const size_t n) {
+    disjoint_sets sets;
+    sets.parent.resize(n);
+    sets.size.assign(n, 1);
+    for (size_t idx = 0; idx < n; idx++) {
+        sets.parent.at(idx) = idx;
+    }
+    return sets;
+}
+
+size_t find_set(disjoint_sets &sets, size_t idx) {
+    while (sets.parent.at(idx) != idx) {
+        sets.parent.at(idx) = sets.parent.at(sets.parent.at(idx));
+        idx = sets.parent.at(idx);
+    }
+    return idx;
+}
+
+// Merges the sets holding a and b, returns false if they were already merged
+bool union_sets(disjoint_sets &sets, size_t a, size_t b) {
+    a = find_set(sets, a);
+    b = find_set(sets, b);
+    if (a == b) {
+        return false;
+    }
+
+    if (sets.size.at(a) < sets.size.at(b)) {
+        std::swap(a, b);
+    }
+    sets.parent.at(b) = a;
+    sets.size.at(a) += sets.size.at(b);
+    return true;
+}
+
 // Gets the number of edges in an adjacency list representation of the graph
 size_t num_edges(const adjacency_list &adj_list) {
     size_t n_edges = 0;
@@ -374,8 +570,7 @@ void write_graph(const adjacency_list &adj_list,
 	const std::string file_path) {
     edge_list edges_out = to_edge_list(adj_list);
 
-    std::ofstream file_out;
-    file_out.open(file_path);
+    std::unique_ptr<std::ostream> file_out = open_output(file_path);
 
     // a hack to quickly dedup, should do nicer
     std::unordered_set<std::string> ledger;
@@ -391,11 +586,11 @@ void write_graph(const adjacency_list &adj_list,
 	auto search_1 = ledger.find(edge_repr_1);
 
 	if (search_0 == ledger.end() && search_1 == ledger.end()) {
-	    file_out << edge_repr_0 << "\n";
+	    *file_out << edge_repr_0 << "\n";
 	    ledger.insert(edge_repr_0);
 	    ledger.insert(edge_repr_1);
 	}
     }
-
-    file_out.close();
 }
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include "trace.h"
+#include "utils.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#define WRITER_BUFFER_SIZE (1 << 22)
+
+// Hash for edges stored with the smaller node first
+struct edge_hash {
+    size_t operator()(const std::pair<node, node> &edge) const {
+        return std::hash<node>()(edge.first) * 31 + std::hash<node>()(edge.second);
+    }
+};
+
+// Writes edges to the output from a background thread while the algorithm
+// is still running. Batches of edges are queued with push and written with
+// large buffered writes, so downstream consumers can start reading before
+// the run finishes. A file path of "-" writes to stdout, FIFOs also work,
+// and .gz or .zst paths are compressed (see streams.h).
+//
+// Edges are given as flat vectors of node pairs, the same layout that
+// propagate_from_x returns. Edges already written are skipped
+struct edge_writer {
+    edge_writer(const std::string &file_path,
+	    const std::unordered_map<node, std::string> &node_labels)
+	: labels(node_labels), file_out(open_output(file_path)) {
+	buffer.reserve(WRITER_BUFFER_SIZE);
+	worker = std::thread(&edge_writer::run, this);
+    }
+
+    ~edge_writer() {
+	finish();
+    }
+
+    edge_writer(const edge_writer &) = delete;
+    edge_writer &operator=(const edge_writer &) = delete;
+
+    // Queues a batch of edges to be written
+    void push(std::vector<node> edges) {
+	{
+	    std::lock_guard<std::mutex> lock(mutex);
+	    batches.push_back(std::move(edges));
+	}
+	ready.notify_one();
+    }
+
+    void push(const edge_list &edges) {
+	std::vector<node> flat;
+	flat.reserve(edges.size() * 2);
+	for (std::pair<node, node> edge : edges) {
+	    flat.push_back(edge.first);
+	    flat.push_back(edge.second);
+	}
+	push(std::move(flat));
+    }
+
+    // Writes out everything queued so far and closes the output. Returns
+    // whether all writes succeeded
+    bool finish() {
+	if (worker.joinable()) {
+	    {
+		std::lock_guard<std::mutex> lock(mutex);
+		done = true;
+	    }
+	    ready.notify_one();
+	    worker.join();
+
+	    file_out->flush();
+	    failed |= !file_out->good();
+	    // destroying the stream completes any compressed output
+	    file_out.reset();
+	}
+	return !failed;
+    }
+
+    size_t edges_written() const {
+	return num_written;
+    }
+
+private:
+    const std::unordered_map<node, std::string> &labels;
+    std::unique_ptr<std::ostream> file_out;
+    std::string buffer;
+    std::unordered_set<std::pair<node, node>, edge_hash> ledger;
+    size_t num_written = 0;
+    bool failed = false;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::vector<node>> batches;
+    bool done = false;
+    std::thread worker;
+
+    void append_node(const node this_node) {
+	if (labels.empty()) {
+	    buffer += std::to_string(this_node);
+	} else {
+	    buffer += labels.at(this_node);
+	}
+    }
+
+    void flush_buffer() {
+	if (!buffer.empty()) {
+	    file_out->write(buffer.data(), buffer.size());
+	}
+	buffer.clear();
+    }
+
+    void write_batch(const std::vector<node> &edges) {
+	for (size_t idx = 0; idx + 1 < edges.size(); idx += 2) {
+	    const node node_0 = std::min(edges.at(idx), edges.at(idx + 1));
+	    const node node_1 = std::max(edges.at(idx), edges.at(idx + 1));
+
+	    if (node_0 != node_1 && ledger.insert(std::make_pair(node_0, node_1)).second) {
+		append_node(edges.at(idx));
+		buffer += ' ';
+		append_node(edges.at(idx + 1));
+		buffer += '\n';
+		num_written++;
+
+		if (buffer.size() >= WRITER_BUFFER_SIZE) {
+		    flush_buffer();
+		}
+	    }
+	}
+    }
+
+    void run() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true) {
+	    ready.wait(lock, [this] { return done || !batches.empty(); });
+
+	    if (batches.empty()) {
+		break;
+	    }
+
+	    std::vector<node> batch = std::move(batches.front());
+	    batches.pop_front();
+
+	    // the queue is unlocked while writing so producers never wait on
+	    // the disk
+	    lock.unlock();
+	    {
+		trace_scope write_span("write batch");
+		write_batch(batch);
+	    }
+	    lock.lock();
+
+	    // flush whenever caught up so readers see each batch promptly
+	    if (batches.empty()) {
+		lock.unlock();
+		flush_buffer();
+		file_out->flush();
+		lock.lock();
+	    }
+	}
+	lock.unlock();
+
+	flush_buffer();
+    }
+};
+
+#endif